@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Layout of the binary log written by Logger::startBinaryLog and read by tools/logdecode. The file starts with the
+// magic and the version, followed by the records. Each record is its type (u8), the size of its payload (u32) and the
+// payload. The call sites and the modules are defined by their own records before the first message using them, so
+// the messages only carry ids. Numbers are little-endian.
+namespace Logger::BinaryLogFormat
+{
+    constexpr char Magic[6] = {'I', 'D', 'A', 'L', 'O', 'G'};
+    constexpr uint16_t Version = 1;
+    constexpr size_t FileHeaderSize = sizeof(Magic) + sizeof(Version);
+    constexpr size_t RecordHeaderSize = sizeof(uint8_t) + sizeof(uint32_t);
+
+    enum class RecordType : uint8_t
+    {
+        // id (u32), line (u32), file (string), function (string)
+        CallSite = 1,
+        // id (u32), name (string)
+        Module = 2,
+        // call site id (u32), microseconds since the Unix epoch (u64), level (u8), module id (u32, 0 for the host),
+        // then the arguments until the end of the payload
+        Message = 3
+    };
+
+    // Each argument is its type (u8) followed by its value
+    enum class ArgumentType : uint8_t
+    {
+        Int = 1,     // i64
+        UInt = 2,    // u64
+        Double = 3,  // f64
+        Bool = 4,    // u8
+        Char = 5,    // u8
+        String = 6   // string, also used for the values formatted by their operator<<
+    };
+
+    // Strings are their byte length (u32) followed by the UTF-8 bytes
+
+    template <typename T>
+    void append(std::string &buffer, T value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        buffer.append(bytes, sizeof(T));
+    }
+
+    inline void appendString(std::string &buffer, std::string_view value)
+    {
+        append(buffer, static_cast<uint32_t>(value.size()));
+        buffer.append(value);
+    }
+
+    // Overwrites a value appended earlier, e.g. a size known only at the end of the record
+    template <typename T>
+    void patch(std::string &buffer, size_t offset, T value)
+    {
+        std::memcpy(buffer.data() + offset, &value, sizeof(T));
+    }
+
+    // Reads the value and advances the cursor. Returns false if the data is truncated.
+    template <typename T>
+    bool read(const char *&cursor, const char *end, T &value)
+    {
+        if (static_cast<size_t>(end - cursor) < sizeof(T))
+        {
+            return false;
+        }
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+
+    inline bool readString(const char *&cursor, const char *end, std::string_view &value)
+    {
+        uint32_t size = 0;
+        if (!read(cursor, end, size) || static_cast<size_t>(end - cursor) < size)
+        {
+            return false;
+        }
+        value = std::string_view(cursor, size);
+        cursor += size;
+        return true;
+    }
+}  // namespace Logger::BinaryLogFormat
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Logger
+{
+    /// @brief Bounded lock-free queue of Dmitry Vyukov. Each cell has a sequence number telling whether it's free for
+    /// the producer of the position or filled for the consumer, so the producers and the consumers only contend on the
+    /// position counters. Pushing to a full queue fails instead of blocking. The values are filled and consumed in
+    /// place, so the cells keep their buffers between the laps.
+    template <typename T>
+    class LogQueue
+    {
+    public:
+        // The capacity is rounded up to a power of two
+        explicit LogQueue(size_t capacity)
+            : mCapacity(std::bit_ceil(capacity < 2 ? size_t{2} : capacity)),
+              mMask(mCapacity - 1),
+              mCells(std::make_unique<Cell[]>(mCapacity))
+        {
+            for (size_t i = 0; i < mCapacity; i++)
+            {
+                mCells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        LogQueue(const LogQueue &) = delete;
+        LogQueue &operator=(const LogQueue &) = delete;
+
+        // The function fills the value of the cell
+        template <typename Fn>
+        bool tryPush(Fn &&fill)
+        {
+            Cell *cell;
+            size_t position = mEnqueuePosition.load(std::memory_order_relaxed);
+            while (true)
+            {
+                cell = &mCells[position & mMask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                if (difference == 0)
+                {
+                    if (mEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    // The consumer has not freed the cell of the previous lap yet
+                    return false;
+                }
+                else
+                {
+                    position = mEnqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+
+            fill(cell->value);
+            cell->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        // The function reads the value of the cell, which is reused after it returns
+        template <typename Fn>
+        bool tryPop(Fn &&consume)
+        {
+            Cell *cell;
+            size_t position = mDequeuePosition.load(std::memory_order_relaxed);
+            while (true)
+            {
+                cell = &mCells[position & mMask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+                if (difference == 0)
+                {
+                    if (mDequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = mDequeuePosition.load(std::memory_order_relaxed);
+                }
+            }
+
+            consume(cell->value);
+            cell->sequence.store(position + mCapacity, std::memory_order_release);
+            return true;
+        }
+
+        size_t getCapacity() const
+        {
+            return mCapacity;
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        const size_t mCapacity;
+        const size_t mMask;
+        std::unique_ptr<Cell[]> mCells;
+        // On separate cache lines, so the producers don't slow down the consumer
+        alignas(64) std::atomic<size_t> mEnqueuePosition = 0;
+        alignas(64) std::atomic<size_t> mDequeuePosition = 0;
+    };
+}  // namespace Logger
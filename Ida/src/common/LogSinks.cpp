@@ -0,0 +1,88 @@
+#include "LogSinks.h"
+
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace Logger
+{
+    void ConsoleSink::write(LogStream stream, std::string_view line)
+    {
+        std::ostream &out = stream == LogStream::Err ? std::cerr : std::cout;
+        out << line << '\n';
+    }
+
+    void ConsoleSink::flush()
+    {
+        std::cout.flush();
+        std::cerr.flush();
+    }
+
+    FileSink::FileSink(const std::string &filePath, bool append)
+        : mFile(filePath, std::ios::binary | (append ? std::ios::app : std::ios::trunc))
+    {
+        if (!mFile.is_open())
+        {
+            std::cerr << "Failed to open the log file " << filePath << std::endl;
+        }
+    }
+
+    void FileSink::write(LogStream, std::string_view line)
+    {
+        mFile << line << '\n';
+    }
+
+    void FileSink::flush()
+    {
+        mFile.flush();
+    }
+
+    RotatingFileSink::RotatingFileSink(const std::string &filePath, size_t maxFileBytes, int maxBackupFiles)
+        : mFilePath(filePath), mMaxFileBytes(maxFileBytes), mMaxBackupFiles(maxBackupFiles)
+    {
+        std::error_code error;
+        uintmax_t size = fs::file_size(filePath, error);
+        mFileBytes = error ? 0 : static_cast<size_t>(size);
+        mFile.open(filePath, std::ios::binary | std::ios::app);
+        if (!mFile.is_open())
+        {
+            std::cerr << "Failed to open the log file " << filePath << std::endl;
+        }
+    }
+
+    void RotatingFileSink::write(LogStream, std::string_view line)
+    {
+        if (mFileBytes > 0 && mFileBytes + line.size() + 1 > mMaxFileBytes)
+        {
+            rotate();
+        }
+
+        mFile << line << '\n';
+        mFileBytes += line.size() + 1;
+    }
+
+    void RotatingFileSink::flush()
+    {
+        mFile.flush();
+    }
+
+    void RotatingFileSink::rotate()
+    {
+        mFile.close();
+
+        std::error_code error;
+        if (mMaxBackupFiles > 0)
+        {
+            fs::remove(mFilePath + "." + std::to_string(mMaxBackupFiles), error);
+            for (int i = mMaxBackupFiles - 1; i >= 1; i--)
+            {
+                fs::rename(mFilePath + "." + std::to_string(i), mFilePath + "." + std::to_string(i + 1), error);
+            }
+            fs::rename(mFilePath, mFilePath + ".1", error);
+        }
+
+        mFile.open(mFilePath, std::ios::binary | std::ios::trunc);
+        mFileBytes = 0;
+    }
+}  // namespace Logger
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace Logger
+{
+    enum class LogStream : uint8_t
+    {
+        Out,
+        Err
+    };
+
+    /// @brief Destination of the log lines. Sinks are called by one thread at a time, the writer thread when the
+    /// logger is asynchronous.
+    class LogSink
+    {
+    public:
+        virtual ~LogSink() = default;
+
+        // The line has no line break
+        virtual void write(LogStream stream, std::string_view line) = 0;
+        virtual void flush() = 0;
+    };
+
+    // Writes to stdout, or stderr for the warnings and errors
+    class ConsoleSink : public LogSink
+    {
+    public:
+        void write(LogStream stream, std::string_view line) override;
+        void flush() override;
+    };
+
+    class FileSink : public LogSink
+    {
+    public:
+        explicit FileSink(const std::string &filePath, bool append = true);
+
+        void write(LogStream stream, std::string_view line) override;
+        void flush() override;
+
+    private:
+        std::ofstream mFile;
+    };
+
+    /// @brief Writes to the file until it reaches the size limit, then renames it to "path.1", the previous "path.1"
+    /// to "path.2" and so on, keeping up to maxBackupFiles old files.
+    class RotatingFileSink : public LogSink
+    {
+    public:
+        RotatingFileSink(const std::string &filePath, size_t maxFileBytes, int maxBackupFiles);
+
+        void write(LogStream stream, std::string_view line) override;
+        void flush() override;
+
+    private:
+        std::string mFilePath;
+        size_t mMaxFileBytes;
+        int mMaxBackupFiles;
+        size_t mFileBytes = 0;
+        std::ofstream mFile;
+
+        void rotate();
+    };
+}  // namespace Logger
@@ -1,37 +1,735 @@
 #include "Logger.h"
 
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "BinaryLogFormat.h"
+#include "LogQueue.h"
 
 namespace Logger
 {
     static LogLevel logLevel = LogLevel::INFO;
     static LogLevel jsLogLevel = LogLevel::INFO;
-    static std::string jsModuleName = "unknown";
 
-    LogLine::LogLine(bool isVoid, const std::string &prefix, std::ostream &outStream)
-        : mIsVoid(isVoid), mPrefix(prefix), mOut(outStream), mNeedPrefix(true)
+    // Never changed once published: setJsModuleName replaces the whole module, and the lines keep the one they
+    // started with
+    struct JsModule
+    {
+        std::string name;
+        // Prefixes of the lines by level, built when the module name changes instead of on every line
+        std::array<std::string, 4> prefixes;
+        // Id of the name in the binary log, 0 being the host
+        uint32_t id;
+        // Binary log generation whose file has the name, which is written again when a new file starts
+        mutable std::atomic<uint32_t> definedGeneration = 0;
+    };
+
+    static std::shared_ptr<const JsModule> makeJsModule(const std::string &name, uint32_t id)
+    {
+        auto module = std::make_shared<JsModule>();
+        module->name = name;
+        module->prefixes = {"[" + name + "] [dbg] ", "[" + name + "] [inf] ", "[" + name + "] [wrn] ",
+                            "[" + name + "] [err] "};
+        module->id = id;
+        return module;
+    }
+
+    // Taken to rename the module, to copy it, and to write its name to a new binary log file
+    static std::mutex jsModuleMutex;
+    static std::shared_ptr<const JsModule> jsModule = makeJsModule("unknown", 1);
+    // Id of jsModule, read without the mutex to know when it was renamed
+    static std::atomic<uint32_t> jsModuleId = 1;
+
+    // The thread copies the module again only when it was renamed, so the lines don't take the mutex
+    static std::shared_ptr<const JsModule> getJsModule()
+    {
+        static thread_local std::shared_ptr<const JsModule> threadModule;
+        if (!threadModule || threadModule->id != jsModuleId.load(std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lock(jsModuleMutex);
+            threadModule = jsModule;
+        }
+        return threadModule;
+    }
+
+    static std::atomic<bool> isBinaryMode = false;
+    // Incremented by each startBinaryLog, so the call sites and the modules of the previous file are written again
+    static std::atomic<uint32_t> binaryLogGeneration = 0;
+
+    struct LogMessage
+    {
+        LogStream stream = LogStream::Out;
+        // A record of the binary log instead of a line of text
+        bool isBinary = false;
+        std::string text;
+    };
+
+    // Async-signal-safe, unlike the streams
+    static void writeToDescriptor(int descriptor, const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+#ifdef _WIN32
+            int written = _write(descriptor, data, static_cast<unsigned int>(size));
+#else
+            ssize_t written = ::write(descriptor, data, size);
+#endif
+            if (written <= 0)
+            {
+                return;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    static int openAppendDescriptor(const std::string &filePath)
+    {
+#ifdef _WIN32
+        return _open(filePath.c_str(), _O_WRONLY | _O_APPEND | _O_BINARY);
+#else
+        return ::open(filePath.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+#endif
+    }
+
+    static void closeDescriptor(int descriptor)
+    {
+#ifdef _WIN32
+        _close(descriptor);
+#else
+        ::close(descriptor);
+#endif
+    }
+
+    // Sinks and the background writer. The sinks are only called under the mutex, which the writer thread holds
+    // uncontended while the logger is asynchronous.
+    class LogBackend
+    {
+    public:
+        ~LogBackend()
+        {
+            stopAsync();
+        }
+
+        void addSink(std::unique_ptr<LogSink> sink)
+        {
+            std::lock_guard<std::mutex> lock(mSinkMutex);
+            mSinks.push_back(std::move(sink));
+        }
+
+        void clearSinks()
+        {
+            std::lock_guard<std::mutex> lock(mSinkMutex);
+            flushSinks();
+            mSinks.clear();
+        }
+
+        void submit(LogStream stream, std::string_view text, bool isBinary = false)
+        {
+            if (mIsAsync.load(std::memory_order_acquire))
+            {
+                // Copied into the string of the cell, which has the capacity of the earlier lines
+                auto fill = [&](LogMessage &message) {
+                    message.stream = stream;
+                    message.isBinary = isBinary;
+                    message.text.assign(text);
+                };
+                if (mQueue->tryPush(fill))
+                {
+                    mEnqueuedCount.fetch_add(1, std::memory_order_relaxed);
+                    mWakeSignal.fetch_add(1, std::memory_order_release);
+                    mWakeSignal.notify_one();
+                }
+                else
+                {
+                    mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+                }
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mSinkMutex);
+            writeMessage(stream, text, isBinary);
+        }
+
+        // The records defining the call sites and the modules are never dropped, or the messages using them could not
+        // be decoded. They are written at once, ahead of the queued messages, which only matters for being before the
+        // messages using them.
+        void writeDefinition(std::string_view record)
+        {
+            std::lock_guard<std::mutex> lock(mSinkMutex);
+            writeMessage(LogStream::Out, record, true);
+            // Flushed at once, so the records written by the crash signal handler after it can still be decoded
+            if (mBinaryFile.is_open())
+            {
+                mBinaryFile.flush();
+            }
+        }
+
+        bool openBinaryFile(const std::string &filePath)
+        {
+            std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+            file.write(BinaryLogFormat::Magic, sizeof(BinaryLogFormat::Magic));
+            file.write(reinterpret_cast<const char *>(&BinaryLogFormat::Version), sizeof(BinaryLogFormat::Version));
+            file.flush();
+            if (!file)
+            {
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock(mSinkMutex);
+            mBinaryFile.close();
+            mBinaryFile = std::move(file);
+            replaceBinaryDescriptor(openAppendDescriptor(filePath));
+            return true;
+        }
+
+        void closeBinaryFile()
+        {
+            std::lock_guard<std::mutex> lock(mSinkMutex);
+            mBinaryFile.close();
+            replaceBinaryDescriptor(-1);
+        }
+
+        void startAsync(size_t queueCapacity)
+        {
+            std::lock_guard<std::mutex> lock(mControlMutex);
+            if (mIsAsync)
+            {
+                return;
+            }
+
+            // The queue is kept after stopAsync, as a thread may still be pushing the line it started before the stop
+            if (!mQueue)
+            {
+                mQueue = std::make_unique<LogQueue<LogMessage>>(queueCapacity);
+            }
+            mIsStopping = false;
+            mWriter = std::thread(&LogBackend::runWriter, this);
+            mIsAsync.store(true, std::memory_order_release);
+        }
+
+        void stopAsync()
+        {
+            std::lock_guard<std::mutex> lock(mControlMutex);
+            if (!mIsAsync)
+            {
+                return;
+            }
+
+            mIsAsync.store(false, std::memory_order_release);
+            mIsStopping = true;
+            mWakeSignal.fetch_add(1, std::memory_order_release);
+            mWakeSignal.notify_one();
+            mWriter.join();
+
+            // Lines pushed by the threads that saw the logger as asynchronous just before it stopped
+            std::lock_guard<std::mutex> sinkLock(mSinkMutex);
+            drainQueue();
+            flushSinks();
+        }
+
+        bool isAsync() const
+        {
+            return mIsAsync.load(std::memory_order_acquire);
+        }
+
+        void flush()
+        {
+            if (!mIsAsync.load(std::memory_order_acquire))
+            {
+                std::lock_guard<std::mutex> lock(mSinkMutex);
+                flushSinks();
+                return;
+            }
+
+            uint64_t target = mEnqueuedCount.load(std::memory_order_relaxed);
+            while (mIsAsync.load(std::memory_order_acquire) && mWrittenCount.load(std::memory_order_acquire) < target)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        uint64_t getDroppedCount() const
+        {
+            return mDroppedCount.load(std::memory_order_relaxed);
+        }
+
+        // Best effort: std::terminate may be called with the sink mutex held. The writer thread may hold it while it
+        // terminates, and locking it again there is undefined, so nothing is written from that thread. The other
+        // threads wait for the lock a moment, and give up if it's still held.
+        void flushOnTerminate()
+        {
+            if (mIsCrashing.test_and_set())
+            {
+                return;
+            }
+
+            if (mIsAsync.load(std::memory_order_acquire) &&
+                std::this_thread::get_id() == mWriterId.load(std::memory_order_acquire))
+            {
+                return;
+            }
+
+            std::unique_lock<std::mutex> lock(mSinkMutex, std::defer_lock);
+            for (int attempt = 0; attempt < 100 && !lock.try_lock(); attempt++)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (!lock.owns_lock())
+            {
+                return;
+            }
+
+            if (mQueue)
+            {
+                drainQueue();
+            }
+            flushSinks();
+        }
+
+        // Called by the crash signal handler, where the mutex, the sinks and their streams can't be used. Only the
+        // lock-free queue is read, and its raw buffers are written with write(2): the text lines to stdout or stderr
+        // and the binary records to the binary log file. The file sinks only keep what was written before the crash.
+        void writeQueuedOnSignal()
+        {
+            if (mIsCrashing.test_and_set() || !mQueue)
+            {
+                return;
+            }
+
+            int binaryDescriptor = mBinaryDescriptor.load(std::memory_order_acquire);
+            auto write = [binaryDescriptor](LogMessage &message) {
+                if (message.isBinary)
+                {
+                    if (binaryDescriptor >= 0)
+                    {
+                        writeToDescriptor(binaryDescriptor, message.text.data(), message.text.size());
+                    }
+                    return;
+                }
+                int descriptor = message.stream == LogStream::Err ? 2 : 1;
+                writeToDescriptor(descriptor, message.text.data(), message.text.size());
+                writeToDescriptor(descriptor, "\n", 1);
+            };
+            while (mQueue->tryPop(write))
+            {
+            }
+        }
+
+    private:
+        std::mutex mControlMutex;
+        std::mutex mSinkMutex;
+        std::vector<std::unique_ptr<LogSink>> mSinks;
+        ConsoleSink mDefaultSink;
+        std::ofstream mBinaryFile;
+        // The binary log file opened again, for the crash signal handler
+        std::atomic<int> mBinaryDescriptor = -1;
+        std::atomic_flag mIsCrashing = ATOMIC_FLAG_INIT;
+
+        std::unique_ptr<LogQueue<LogMessage>> mQueue;
+        std::thread mWriter;
+        // Set by the writer thread itself, so a crash handler running there sees it even before startAsync returns
+        std::atomic<std::thread::id> mWriterId;
+        std::atomic<bool> mIsAsync = false;
+        std::atomic<bool> mIsStopping = false;
+        std::atomic<uint64_t> mWakeSignal = 0;
+        std::atomic<uint64_t> mEnqueuedCount = 0;
+        std::atomic<uint64_t> mWrittenCount = 0;
+        std::atomic<uint64_t> mDroppedCount = 0;
+        uint64_t mReportedDroppedCount = 0;
+
+        // Needs the sink mutex
+        void replaceBinaryDescriptor(int descriptor)
+        {
+            int previous = mBinaryDescriptor.exchange(descriptor, std::memory_order_acq_rel);
+            if (previous >= 0)
+            {
+                closeDescriptor(previous);
+            }
+        }
+
+        void writeMessage(LogStream stream, std::string_view text, bool isBinary)
+        {
+            if (!isBinary)
+            {
+                writeToSinks(stream, text);
+            }
+            else if (mBinaryFile.is_open())
+            {
+                mBinaryFile.write(text.data(), static_cast<std::streamsize>(text.size()));
+            }
+        }
+
+        void writeToSinks(LogStream stream, std::string_view line)
+        {
+            if (mSinks.empty())
+            {
+                mDefaultSink.write(stream, line);
+                return;
+            }
+
+            for (auto &sink : mSinks)
+            {
+                sink->write(stream, line);
+            }
+        }
+
+        void flushSinks()
+        {
+            if (mBinaryFile.is_open())
+            {
+                mBinaryFile.flush();
+            }
+
+            if (mSinks.empty())
+            {
+                mDefaultSink.flush();
+                return;
+            }
+
+            for (auto &sink : mSinks)
+            {
+                sink->flush();
+            }
+        }
+
+        // Needs the sink mutex. Returns the number of lines written.
+        uint64_t drainQueue()
+        {
+            uint64_t count = 0;
+            auto write = [this](LogMessage &message) { writeMessage(message.stream, message.text, message.isBinary); };
+            while (mQueue->tryPop(write))
+            {
+                count++;
+            }
+
+            uint64_t droppedCount = mDroppedCount.load(std::memory_order_relaxed);
+            if (droppedCount != mReportedDroppedCount)
+            {
+                writeToSinks(LogStream::Err, "[wrn] " + std::to_string(droppedCount - mReportedDroppedCount) +
+                                                 " log lines dropped, the log queue was full");
+                mReportedDroppedCount = droppedCount;
+            }
+            return count;
+        }
+
+        void runWriter()
+        {
+            mWriterId.store(std::this_thread::get_id(), std::memory_order_release);
+            while (true)
+            {
+                // Read before draining, so a line pushed after the drain changes it and the wait returns
+                uint64_t wakeSignal = mWakeSignal.load(std::memory_order_acquire);
+                {
+                    std::lock_guard<std::mutex> lock(mSinkMutex);
+                    uint64_t count = drainQueue();
+                    if (count > 0)
+                    {
+                        flushSinks();
+                        mWrittenCount.fetch_add(count, std::memory_order_release);
+                    }
+                }
+
+                if (mIsStopping)
+                {
+                    return;
+                }
+                mWakeSignal.wait(wakeSignal, std::memory_order_acquire);
+            }
+        }
+    };
+
+    static LogBackend backend;
+
+    // Ids of the call sites in the binary log. The record defining a site is written before the id is returned, so it's
+    // ahead of the messages of the site. The threads cache the ids they have seen, so only the first line of each site
+    // takes the lock.
+    class CallSiteRegistry
+    {
+    public:
+        uint32_t getId(const std::source_location &location, uint32_t generation)
+        {
+            Key key{location.file_name(), location.line(), location.column()};
+            auto cached = threadCache.find(key);
+            if (cached != threadCache.end() && cached->second.generation == generation)
+            {
+                return cached->second.id;
+            }
+
+            uint32_t id;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                startGeneration(generation);
+
+                auto [site, isNew] = mIds.try_emplace(key, mNextId);
+                id = site->second;
+                if (isNew)
+                {
+                    mNextId++;
+                    writeDefinition(id, location.line(), location.file_name(), location.function_name());
+                }
+            }
+            threadCache[key] = {id, generation};
+            return id;
+        }
+
+        // Sites known by their names, cached by the callers
+        uint32_t getId(std::string_view file, uint32_t line, std::string_view function, uint32_t generation)
+        {
+            std::string key;
+            key.reserve(file.size() + function.size() + 16);
+            key.append(file).append(1, '\0').append(std::to_string(line)).append(1, '\0').append(function);
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            startGeneration(generation);
+
+            auto [site, isNew] = mNamedIds.try_emplace(std::move(key), mNextId);
+            if (isNew)
+            {
+                mNextId++;
+                writeDefinition(site->second, line, file, function);
+            }
+            return site->second;
+        }
+
+    private:
+        // The file name pointers of a translation unit are the same, so they are compared rather than the names
+        struct Key
+        {
+            const char *file;
+            uint32_t line;
+            uint32_t column;
+
+            bool operator==(const Key &other) const = default;
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const Key &key) const
+            {
+                size_t hash = std::hash<const char *>{}(key.file);
+                hash ^= (static_cast<size_t>(key.line) << 16 | key.column) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+                return hash;
+            }
+        };
+
+        struct CachedId
+        {
+            uint32_t id;
+            uint32_t generation;
+        };
+
+        std::mutex mMutex;
+        std::unordered_map<Key, uint32_t, KeyHash> mIds;
+        // By the file, the line and the function separated by '\0'
+        std::unordered_map<std::string, uint32_t> mNamedIds;
+        uint32_t mNextId = 1;
+        uint32_t mGeneration = 0;
+        static inline thread_local std::unordered_map<Key, CachedId, KeyHash> threadCache;
+
+        // Needs the mutex. The ids start again in a new file.
+        void startGeneration(uint32_t generation)
+        {
+            if (mGeneration != generation)
+            {
+                mIds.clear();
+                mNamedIds.clear();
+                mNextId = 1;
+                mGeneration = generation;
+            }
+        }
+
+        static void writeDefinition(uint32_t id, uint32_t line, std::string_view file, std::string_view function)
+        {
+            using namespace BinaryLogFormat;
+            std::string record;
+            append(record, RecordType::CallSite);
+            append(record, uint32_t{0});
+            append(record, id);
+            append(record, line);
+            appendString(record, file);
+            appendString(record, function);
+            patch(record, sizeof(RecordType), static_cast<uint32_t>(record.size() - RecordHeaderSize));
+            backend.writeDefinition(record);
+        }
+    };
+
+    static CallSiteRegistry callSites;
+
+    static void writeModuleDefinition(uint32_t id, std::string_view name)
+    {
+        using namespace BinaryLogFormat;
+        std::string record;
+        append(record, RecordType::Module);
+        append(record, uint32_t{0});
+        append(record, id);
+        appendString(record, name);
+        patch(record, sizeof(RecordType), static_cast<uint32_t>(record.size() - RecordHeaderSize));
+        backend.writeDefinition(record);
+    }
+
+    LineBuffer::int_type LineBuffer::overflow(int_type c)
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            text.push_back(traits_type::to_char_type(c));
+        }
+        return c;
+    }
+
+    std::streamsize LineBuffer::xsputn(const char *s, std::streamsize count)
+    {
+        text.append(s, static_cast<size_t>(count));
+        return count;
+    }
+
+    static thread_local LineStream threadLineStream;
+
+    LogLine::LogLine(bool isVoid, std::string_view prefix, LogStream stream, LogLevel level,
+                     const std::source_location &location)
+        : mIsVoid(isVoid), mPrefix(prefix), mStream(stream), mNeedPrefix(true)
+    {
+        if (!mIsVoid)
+        {
+            begin(level, false, &location, 0);
+        }
+    }
+
+    LogLine::LogLine(bool isVoid, std::shared_ptr<const JsModule> module, LogStream stream, LogLevel level,
+                     uint32_t jsCallSiteId)
+        : mIsVoid(isVoid),
+          mPrefix(module->prefixes[static_cast<size_t>(level)]),
+          mStream(stream),
+          mJsModule(std::move(module)),
+          mNeedPrefix(true)
     {
+        if (!mIsVoid)
+        {
+            begin(level, true, nullptr, jsCallSiteId);
+        }
+    }
+
+    void LogLine::begin(LogLevel level, bool isJs, const std::source_location *location, uint32_t callSiteId)
+    {
+        if (threadLineStream.isInUse)
+        {
+            mNestedLine = std::make_unique<LineStream>();
+            mLine = mNestedLine.get();
+        }
+        else
+        {
+            mLine = &threadLineStream;
+            mLine->buffer.text.clear();
+            // The manipulators of the previous line must not leak into this one
+            mLine->stream.flags(std::ios_base::dec | std::ios_base::skipws);
+            mLine->stream.precision(6);
+            mLine->stream.fill(' ');
+        }
+        mLine->isInUse = true;
+
+        if (!isBinaryMode.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        // The message starts with its header, and the arguments are appended by the operators
+        using namespace BinaryLogFormat;
+        uint32_t generation = binaryLogGeneration.load(std::memory_order_relaxed);
+        if (location)
+        {
+            callSiteId = callSites.getId(*location, generation);
+        }
+        uint32_t moduleId = 0;
+        if (isJs)
+        {
+            // Stored after the writing, so no line of the module gets ahead of its name in the file
+            if (mJsModule->definedGeneration.load(std::memory_order_acquire) != generation)
+            {
+                std::lock_guard<std::mutex> lock(jsModuleMutex);
+                if (mJsModule->definedGeneration.load(std::memory_order_relaxed) != generation)
+                {
+                    writeModuleDefinition(mJsModule->id, mJsModule->name);
+                    mJsModule->definedGeneration.store(generation, std::memory_order_release);
+                }
+            }
+            moduleId = mJsModule->id;
+        }
+
+        using namespace std::chrono;
+        auto timestamp = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+
+        std::string &record = mLine->buffer.text;
+        append(record, RecordType::Message);
+        append(record, uint32_t{0});
+        append(record, callSiteId);
+        append(record, static_cast<uint64_t>(timestamp));
+        append(record, static_cast<uint8_t>(level));
+        append(record, moduleId);
+        mIsBinary = true;
+        mNeedPrefix = false;
     }
 
     LogLine &LogLine::operator<<(const char *s)
     {
-        if (mIsVoid || s == nullptr || *s == '\0')
+        if (mIsVoid || s == nullptr)
+        {
+            return *this;
+        }
+        // Kept when empty, as the decoder puts spaces between the arguments of the JS lines
+        if (mIsBinary)
+        {
+            writeStringArgument(s);
+            return *this;
+        }
+        if (*s == '\0')
         {
             return *this;
         }
         printPrefixIfNeeded();
-        mOut << s;
+        mLine->buffer.text.append(s);
         return *this;
     }
 
     LogLine &LogLine::operator<<(const std::string &s)
     {
-        if (mIsVoid || s.empty())
+        return *this << std::string_view(s);
+    }
+
+    LogLine &LogLine::operator<<(std::string_view s)
+    {
+        if (mIsVoid)
+        {
+            return *this;
+        }
+        if (mIsBinary)
+        {
+            writeStringArgument(s);
+            return *this;
+        }
+        if (s.empty())
         {
             return *this;
         }
         printPrefixIfNeeded();
-        mOut << s;
+        mLine->buffer.text.append(s);
         return *this;
     }
 
@@ -42,8 +740,24 @@ namespace Logger
             return *this;
         }
 
+        if (mIsBinary)
+        {
+            // A manipulator changing the format writes nothing, and leaves no argument
+            size_t start = beginFormattedArgument();
+            mLine->stream << manip;
+            if (mLine->buffer.text.size() == start + sizeof(uint32_t))
+            {
+                mLine->buffer.text.resize(start - sizeof(BinaryLogFormat::ArgumentType));
+            }
+            else
+            {
+                endFormattedArgument(start);
+            }
+            return *this;
+        }
+
         printPrefixIfNeeded();
-        mOut << manip;
+        mLine->stream << manip;
         return *this;
     }
 
@@ -51,17 +765,236 @@ namespace Logger
     {
         if (mNeedPrefix)
         {
-            mOut << mPrefix;
+            mLine->buffer.text.append(mPrefix);
             mNeedPrefix = false;
         }
     }
 
+    void LogLine::writeIntArgument(int64_t value)
+    {
+        BinaryLogFormat::append(mLine->buffer.text, BinaryLogFormat::ArgumentType::Int);
+        BinaryLogFormat::append(mLine->buffer.text, value);
+    }
+
+    void LogLine::writeUIntArgument(uint64_t value)
+    {
+        BinaryLogFormat::append(mLine->buffer.text, BinaryLogFormat::ArgumentType::UInt);
+        BinaryLogFormat::append(mLine->buffer.text, value);
+    }
+
+    void LogLine::writeDoubleArgument(double value)
+    {
+        BinaryLogFormat::append(mLine->buffer.text, BinaryLogFormat::ArgumentType::Double);
+        BinaryLogFormat::append(mLine->buffer.text, value);
+    }
+
+    void LogLine::writeBoolArgument(bool value)
+    {
+        BinaryLogFormat::append(mLine->buffer.text, BinaryLogFormat::ArgumentType::Bool);
+        BinaryLogFormat::append(mLine->buffer.text, static_cast<uint8_t>(value));
+    }
+
+    void LogLine::writeCharArgument(char value)
+    {
+        BinaryLogFormat::append(mLine->buffer.text, BinaryLogFormat::ArgumentType::Char);
+        BinaryLogFormat::append(mLine->buffer.text, value);
+    }
+
+    void LogLine::writeStringArgument(std::string_view value)
+    {
+        BinaryLogFormat::append(mLine->buffer.text, BinaryLogFormat::ArgumentType::String);
+        BinaryLogFormat::appendString(mLine->buffer.text, value);
+    }
+
+    size_t LogLine::beginFormattedArgument()
+    {
+        BinaryLogFormat::append(mLine->buffer.text, BinaryLogFormat::ArgumentType::String);
+        size_t start = mLine->buffer.text.size();
+        BinaryLogFormat::append(mLine->buffer.text, uint32_t{0});
+        return start;
+    }
+
+    void LogLine::endFormattedArgument(size_t start)
+    {
+        size_t size = mLine->buffer.text.size() - start - sizeof(uint32_t);
+        BinaryLogFormat::patch(mLine->buffer.text, start, static_cast<uint32_t>(size));
+    }
+
     LogLine::~LogLine()
     {
-        if (!mIsVoid)
+        if (mIsVoid)
+        {
+            return;
+        }
+
+        if (mIsBinary)
+        {
+            size_t size = mLine->buffer.text.size() - BinaryLogFormat::RecordHeaderSize;
+            BinaryLogFormat::patch(mLine->buffer.text, sizeof(BinaryLogFormat::RecordType),
+                                   static_cast<uint32_t>(size));
+        }
+        backend.submit(mStream, mLine->buffer.text, mIsBinary);
+        mLine->isInUse = false;
+    }
+
+    void addSink(std::unique_ptr<LogSink> sink)
+    {
+        backend.addSink(std::move(sink));
+    }
+
+    void clearSinks()
+    {
+        backend.clearSinks();
+    }
+
+    void startAsync(size_t queueCapacity)
+    {
+        backend.startAsync(queueCapacity);
+    }
+
+    void stopAsync()
+    {
+        backend.stopAsync();
+    }
+
+    bool isAsync()
+    {
+        return backend.isAsync();
+    }
+
+    void flush()
+    {
+        backend.flush();
+    }
+
+    uint64_t getDroppedCount()
+    {
+        return backend.getDroppedCount();
+    }
+
+    bool startBinaryLog(const std::string &filePath)
+    {
+        // The lines of the previous file are written before it's replaced
+        backend.flush();
+        if (!backend.openBinaryFile(filePath))
+        {
+            return false;
+        }
+
+        binaryLogGeneration.fetch_add(1, std::memory_order_relaxed);
+        isBinaryMode.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void stopBinaryLog()
+    {
+        isBinaryMode.store(false, std::memory_order_relaxed);
+        backend.flush();
+        backend.closeBinaryFile();
+    }
+
+    bool isBinaryLog()
+    {
+        return isBinaryMode.load(std::memory_order_relaxed);
+    }
+
+    uint32_t getBinaryLogGeneration()
+    {
+        return binaryLogGeneration.load(std::memory_order_relaxed);
+    }
+
+    uint32_t getCallSiteId(std::string_view file, uint32_t line, std::string_view function, uint32_t generation)
+    {
+        return callSites.getId(file, line, function, generation);
+    }
+
+    static std::terminate_handler previousTerminateHandler = nullptr;
+    static constexpr int CrashSignals[] = {SIGSEGV, SIGABRT, SIGFPE, SIGILL};
+
+    static size_t getCrashSignalIndex(int signal)
+    {
+        return std::find(std::begin(CrashSignals), std::end(CrashSignals), signal) - std::begin(CrashSignals);
+    }
+
+#ifdef _WIN32
+    using SignalHandler = void (*)(int);
+    static SignalHandler previousSignalHandlers[std::size(CrashSignals)] = {};
+
+    // Without sigaction, the handler is reset to the default before the call, so the previous one is set back
+    static void onCrashSignal(int signal)
+    {
+        backend.writeQueuedOnSignal();
+
+        SignalHandler previous = previousSignalHandlers[getCrashSignalIndex(signal)];
+        std::signal(signal, previous);
+        if (previous != SIG_DFL && previous != SIG_IGN && previous != SIG_ERR)
+        {
+            previous(signal);
+        }
+        else
+        {
+            std::raise(signal);
+        }
+    }
+#else
+    static struct sigaction previousSignalActions[std::size(CrashSignals)] = {};
+
+    // Chains to the handler installed before, e.g. by a crash reporter. The default action is taken by restoring it
+    // and raising the signal again, which is delivered when this handler returns.
+    static void onCrashSignal(int signal, siginfo_t *info, void *context)
+    {
+        backend.writeQueuedOnSignal();
+
+        const struct sigaction &previous = previousSignalActions[getCrashSignalIndex(signal)];
+        if (previous.sa_flags & SA_SIGINFO)
+        {
+            previous.sa_sigaction(signal, info, context);
+        }
+        else if (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN)
+        {
+            previous.sa_handler(signal);
+        }
+        else
+        {
+            sigaction(signal, &previous, nullptr);
+            raise(signal);
+        }
+    }
+#endif
+
+    static void onTerminate()
+    {
+        backend.flushOnTerminate();
+        if (previousTerminateHandler)
+        {
+            previousTerminateHandler();
+        }
+        std::abort();
+    }
+
+    void installCrashHandler()
+    {
+        // Installing again would make the handler its own previous one
+        static bool isInstalled = false;
+        if (isInstalled)
+        {
+            return;
+        }
+        isInstalled = true;
+
+        for (size_t i = 0; i < std::size(CrashSignals); i++)
         {
-            mOut << '\n';
+#ifdef _WIN32
+            previousSignalHandlers[i] = std::signal(CrashSignals[i], onCrashSignal);
+#else
+            struct sigaction action = {};
+            action.sa_sigaction = onCrashSignal;
+            action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+            sigemptyset(&action.sa_mask);
+            sigaction(CrashSignals[i], &action, &previousSignalActions[i]);
+#endif
         }
+        previousTerminateHandler = std::set_terminate(onTerminate);
     }
 
     void setLogLevel(LogLevel level)
@@ -86,45 +1019,43 @@ namespace Logger
 
     void setJsModuleName(const std::string name)
     {
-        jsModuleName = name;
+        std::lock_guard<std::mutex> lock(jsModuleMutex);
+        jsModule = makeJsModule(name, jsModule->id + 1);
+        jsModuleId.store(jsModule->id, std::memory_order_release);
     }
 
-    LogLine dbg()
+    LogLine dbg(const std::source_location &location)
     {
-        return LogLine(logLevel > LogLevel::DEBUG, "[dbg] ", std::cout);
+        return LogLine(logLevel > LogLevel::DEBUG, "[dbg] ", LogStream::Out, LogLevel::DEBUG, location);
     }
-    LogLine inf()
+    LogLine inf(const std::source_location &location)
     {
-        return LogLine(logLevel > LogLevel::INFO, "[inf] ", std::cout);
+        return LogLine(logLevel > LogLevel::INFO, "[inf] ", LogStream::Out, LogLevel::INFO, location);
     }
-    LogLine wrn()
+    LogLine wrn(const std::source_location &location)
     {
-        return LogLine(logLevel > LogLevel::WARNING, "[wrn] ", std::cerr);
+        return LogLine(logLevel > LogLevel::WARNING, "[wrn] ", LogStream::Err, LogLevel::WARNING, location);
     }
-    LogLine err()
+    LogLine err(const std::source_location &location)
     {
-        return LogLine(logLevel > LogLevel::ERROR, "[err] ", std::cerr);
+        return LogLine(logLevel > LogLevel::ERROR, "[err] ", LogStream::Err, LogLevel::ERROR, location);
     }
 
-    LogLine jsDbg()
+    LogLine jsDbg(uint32_t callSiteId)
     {
-        std::string prefix = "[" + jsModuleName + "] [dbg] ";
-        return LogLine(jsLogLevel > LogLevel::DEBUG, prefix, std::cout);
+        return LogLine(false, getJsModule(), LogStream::Out, LogLevel::DEBUG, callSiteId);
     }
-    LogLine jsInf()
+    LogLine jsInf(uint32_t callSiteId)
     {
-        std::string prefix = "[" + jsModuleName + "] [inf] ";
-        return LogLine(jsLogLevel > LogLevel::INFO, prefix, std::cout);
+        return LogLine(false, getJsModule(), LogStream::Out, LogLevel::INFO, callSiteId);
     }
-    LogLine jsWrn()
+    LogLine jsWrn(uint32_t callSiteId)
     {
-        std::string prefix = "[" + jsModuleName + "] [wrn] ";
-        return LogLine(jsLogLevel > LogLevel::WARNING, prefix, std::cerr);
+        return LogLine(false, getJsModule(), LogStream::Err, LogLevel::WARNING, callSiteId);
     }
-    LogLine jsErr()
+    LogLine jsErr(uint32_t callSiteId)
     {
-        std::string prefix = "[" + jsModuleName + "] [err] ";
-        return LogLine(jsLogLevel > LogLevel::ERROR, prefix, std::cerr);
+        return LogLine(false, getJsModule(), LogStream::Err, LogLevel::ERROR, callSiteId);
     }
 
 }  // namespace Logger
@@ -1,5 +1,14 @@
 ﻿#pragma once
+#include <cstdint>
+#include <memory>
 #include <ostream>
+#include <source_location>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "LogSinks.h"
 
 namespace Logger
 {
@@ -15,14 +24,102 @@ namespace Logger
     LogLevel getLogLevel();
     void setLogLevel(LogLevel level);
 
+    // Level of the engines created after, each engine then has its own, see core::Engine::setJsLogLevel
     LogLevel getJsLogLevel();
     void setJsLogLevel(LogLevel level);
     void setJsModuleName(const std::string name);
 
+    constexpr size_t DefaultQueueCapacity = 8192;
+
+    /// @brief Adds a destination of the log lines. Without sinks, the lines go to stdout and stderr.
+    void addSink(std::unique_ptr<LogSink> sink);
+    void clearSinks();
+
+    /// @brief Moves the writing to a background thread. The lines are queued without locks, and dropped when the
+    /// queue is full, so a chatty script never waits for the I/O. See getDroppedCount.
+    void startAsync(size_t queueCapacity = DefaultQueueCapacity);
+
+    /// @brief Writes the queued lines and stops the background thread. Called at exit if still running.
+    void stopAsync();
+
+    bool isAsync();
+
+    /// @brief Blocks until the lines logged so far are written
+    void flush();
+
+    /// @brief Lines dropped because the queue was full
+    uint64_t getDroppedCount();
+
+    /// @brief Writes the queued lines when the process crashes or std::terminate is called, so the last lines before
+    /// the crash are not lost. On a crash signal, only the async-signal-safe write(2) is used, so the text lines go to
+    /// stdout or stderr instead of the sinks. The handlers installed before, e.g. by a crash reporter, are called after
+    /// the writing.
+    void installCrashHandler();
+
+    /// @brief Writes the lines to the file in the binary format of BinaryLogFormat.h instead of the sinks. Only the
+    /// call site, the time, the level, the module and the raw argument values are recorded, and the text is made later
+    /// by tools/logdecode. Returns false if the file can't be opened.
+    bool startBinaryLog(const std::string &filePath);
+
+    /// @brief Writes the lines logged so far, closes the file and goes back to the sinks
+    void stopBinaryLog();
+
+    bool isBinaryLog();
+
+    /// @brief Incremented by each startBinaryLog, as the call site ids are only valid in the file they were defined for
+    uint32_t getBinaryLogGeneration();
+
+    /// @brief Id of a call site given by its names, e.g. of a JS line, for the lines of the binary log generation.
+    /// Meant to be cached by the caller for the generation, as the first call of each site takes a lock.
+    uint32_t getCallSiteId(std::string_view file, uint32_t line, std::string_view function, uint32_t generation);
+
+    // Stream appending to a string, which keeps its capacity between the lines
+    class LineBuffer : public std::streambuf
+    {
+    public:
+        std::string text;
+
+    protected:
+        int_type overflow(int_type c) override;
+        std::streamsize xsputn(const char *s, std::streamsize count) override;
+    };
+
+    // Name, prefixes and binary log id of the running JS module, see setJsModuleName
+    struct JsModule;
+
+    struct LineStream
+    {
+        LineBuffer buffer;
+        std::ostream stream{&buffer};
+        bool isInUse = false;
+    };
+
+    /// @brief Formats a line and submits it to the sinks when destroyed. The line is formatted in a buffer reused by
+    /// the thread, and a line of a disabled level does nothing, so the log calls don't allocate. In the binary log,
+    /// the numbers and the strings are recorded as they are, and the other values are formatted by their operator<<.
     class LogLine
     {
     public:
-        explicit LogLine(bool isVoid, const std::string &prefix, std::ostream &outStream);
+        // The prefix must outlive the line
+        LogLine(bool isVoid, std::string_view prefix, LogStream stream, LogLevel level,
+                const std::source_location &location);
+
+        // A JS line, whose call site is from getCallSiteId, or 0 for none. The prefix is the one of the module.
+        LogLine(bool isVoid, std::shared_ptr<const JsModule> module, LogStream stream, LogLevel level,
+                uint32_t jsCallSiteId);
+
+        LogLine(const LogLine &) = delete;
+        LogLine &operator=(const LogLine &) = delete;
+
+        bool isVoid() const
+        {
+            return mIsVoid;
+        }
+
+        bool isBinary() const
+        {
+            return mIsBinary;
+        }
 
         // special-case empty C‑strings: skip prefix+content entirely
         LogLine &operator<<(const char *s);
@@ -30,7 +127,8 @@ namespace Logger
         // special-case empty std::string
         LogLine &operator<<(const std::string &s);
 
-        // manipulators (std::hex, std::dec, etc.)
+        LogLine &operator<<(std::string_view s);
+
         template <typename T>
         LogLine &operator<<(const T &v)
         {
@@ -39,32 +137,93 @@ namespace Logger
                 return *this;
             }
 
+            if (mIsBinary)
+            {
+                writeBinaryArgument(v);
+                return *this;
+            }
+
             printPrefixIfNeeded();
-            mOut << v;
+            mLine->stream << v;
             return *this;
         }
 
+        // manipulators (std::hex, std::dec, etc.), which only apply to the formatted values in the binary log. The
+        // characters written by std::endl or std::ends are recorded there as a string argument.
         LogLine &operator<<(std::ostream &(*manip)(std::ostream &));
 
         ~LogLine();
 
     private:
+        // The call site is resolved from the location for the host lines, only in the binary log
+        void begin(LogLevel level, bool isJs, const std::source_location *location, uint32_t callSiteId);
         void printPrefixIfNeeded();
 
+        template <typename T>
+        void writeBinaryArgument(const T &v)
+        {
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                writeBoolArgument(v);
+            }
+            else if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> ||
+                               std::is_same_v<T, unsigned char>)
+            {
+                writeCharArgument(static_cast<char>(v));
+            }
+            else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+            {
+                writeIntArgument(v);
+            }
+            else if constexpr (std::is_integral_v<T>)
+            {
+                writeUIntArgument(v);
+            }
+            else if constexpr (std::is_floating_point_v<T>)
+            {
+                writeDoubleArgument(static_cast<double>(v));
+            }
+            else
+            {
+                size_t start = beginFormattedArgument();
+                mLine->stream << v;
+                endFormattedArgument(start);
+            }
+        }
+
+        void writeIntArgument(int64_t value);
+        void writeUIntArgument(uint64_t value);
+        void writeDoubleArgument(double value);
+        void writeBoolArgument(bool value);
+        void writeCharArgument(char value);
+        void writeStringArgument(std::string_view value);
+        // The value is formatted by the stream after the returned offset, then turned into a string argument
+        size_t beginFormattedArgument();
+        void endFormattedArgument(size_t start);
+
         bool mIsVoid;
-        const std::string mPrefix;
-        std::ostream &mOut;
+        bool mIsBinary = false;
+        std::string_view mPrefix;
+        LogStream mStream;
+        LineStream *mLine = nullptr;
+        // Keeps the prefix and the id of a JS line while the module is renamed
+        std::shared_ptr<const JsModule> mJsModule;
+        // Used instead of the buffer of the thread by a line logged while formatting another line
+        std::unique_ptr<LineStream> mNestedLine;
         bool mNeedPrefix;
     };
 
-    LogLine dbg();
-    LogLine inf();
-    LogLine wrn();
-    LogLine err();
+    // The location is the call site recorded in the binary log
+    LogLine dbg(const std::source_location &location = std::source_location::current());
+    LogLine inf(const std::source_location &location = std::source_location::current());
+    LogLine wrn(const std::source_location &location = std::source_location::current());
+    LogLine err(const std::source_location &location = std::source_location::current());
 
-    LogLine jsDbg();
-    LogLine jsInf();
-    LogLine jsWrn();
-    LogLine jsErr();
+    // The call site is the JS caller, see getCallSiteId. Not filtered by the JS log level, which the console of each
+    // engine checks against its own.
+    LogLine jsDbg(uint32_t callSiteId = 0);
+    LogLine jsInf(uint32_t callSiteId = 0);
+    LogLine jsWrn(uint32_t callSiteId = 0);
+    LogLine jsErr(uint32_t callSiteId = 0);
 
 }  // namespace Logger
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace core
+{
+    /// @brief Context embedder data indices holding the per-context state of the library objects. The state is not
+    /// passed as template data, so the same templates can be serialized into a startup snapshot. Index 0 is left to V8.
+    enum class ContextSlot : int
+    {
+        Timer = 1,
+        Require = 2
+    };
+
+    /// @brief Isolate data slots, used by static V8 callbacks to find the objects serving their isolate
+    enum class IsolateSlot : uint32_t
+    {
+        Engine = 0,
+        PromiseRejectionHandler = 1
+    };
+}  // namespace core
@@ -0,0 +1,73 @@
+#include "ModSession.h"
+
+#include "engine.h"
+
+namespace core
+{
+    ModSession::ModSession(Engine *engine, const std::string &scriptPath) : mEngine(engine), mScriptPath(scriptPath)
+    {
+        mEngine->mSessions.push_back(this);
+    }
+
+    ModSession::~ModSession()
+    {
+        deactivate();
+        mEngine->cancelTasks(this);
+        std::erase(mEngine->mSessions, this);
+    }
+
+    void ModSession::activate()
+    {
+        if (isActive())
+        {
+            return;
+        }
+
+        if (ModSession *activeSession = mEngine->getActiveSession())
+        {
+            activeSession->deactivate();
+        }
+
+        v8::Isolate *isolate = mEngine->getIsolate();
+        isolate->Enter();
+        v8::HandleScope handleScope(isolate);
+        mContext.Get(isolate)->Enter();
+        mEngine->mActiveSession = this;
+    }
+
+    void ModSession::deactivate()
+    {
+        if (!isActive())
+        {
+            return;
+        }
+
+        v8::Isolate *isolate = mEngine->getIsolate();
+        {
+            v8::HandleScope handleScope(isolate);
+            mContext.Get(isolate)->Exit();
+        }
+        isolate->Exit();
+        mEngine->mActiveSession = nullptr;
+    }
+
+    bool ModSession::isActive() const
+    {
+        return mEngine->getActiveSession() == this;
+    }
+
+    v8::Local<v8::Context> ModSession::inscope_getContext() const
+    {
+        return mContext.Get(mEngine->getIsolate());
+    }
+
+    std::vector<std::string> ModSession::reloadChangedModules()
+    {
+        v8::Isolate *isolate = mEngine->getIsolate();
+        v8::Isolate::Scope isolateScope(isolate);
+        v8::HandleScope handleScope(isolate);
+        v8::Local<v8::Context> context = mContext.Get(isolate);
+        v8::Context::Scope contextScope(context);
+        return mRequire.inscope_reloadChangedModules(context);
+    }
+}  // namespace core
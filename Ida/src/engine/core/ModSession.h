@@ -0,0 +1,60 @@
+#pragma once
+
+#include <v8.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ClientObjects.h"
+#include "library/Require.h"
+#include "library/Timer.h"
+
+namespace core
+{
+    class Engine;
+
+    /// @brief Persistent mod context with its own timers and module cache. Many sessions can live in one isolate and
+    /// only the active one receives the events and function calls of the engine. Created by Engine::createSession and
+    /// destroyed by releasing the pointer, which cancels the pending timers and tasks of the session. All sessions must
+    /// be destroyed before their engine.
+    class ModSession
+    {
+    public:
+        ~ModSession();
+
+        ModSession(const ModSession &) = delete;
+        ModSession &operator=(const ModSession &) = delete;
+
+        /// @brief Enters the isolate and the session context, deactivating the currently active session if any
+        void activate();
+
+        /// @brief Exits the session context and the isolate. Does nothing if the session is not active.
+        void deactivate();
+
+        bool isActive() const;
+
+        v8::Local<v8::Context> inscope_getContext() const;
+
+        /// @brief Re-evaluates the changed modules of the session and their dependents. Meant to be called
+        /// periodically in development builds. Returns the reloaded module paths.
+        std::vector<std::string> reloadChangedModules();
+
+        const std::string &getScriptPath() const
+        {
+            return mScriptPath;
+        }
+
+    private:
+        friend class Engine;
+
+        ModSession(Engine *engine, const std::string &scriptPath);
+
+        Engine *mEngine;
+        std::string mScriptPath;
+        v8::Global<v8::Context> mContext;
+        Timer mTimer;
+        Require mRequire;
+        std::unique_ptr<ClientObjects> mClientObjects;
+    };
+}  // namespace core
@@ -1,6 +1,9 @@
 #pragma once
 #include <v8.h>
 
+#include <optional>
+#include <span>
+
 namespace core
 {
     struct ArgsWithTaskContext
@@ -111,6 +114,120 @@ namespace core
         return {true, checkedValues};
     }
 
+    // Typed array class holding the elements of the given C type
+    template <typename T>
+    struct TypedArrayTraits;
+
+#define IDA_TYPED_ARRAY_TRAITS(CTYPE, CLASS)                 \
+    template <>                                              \
+    struct TypedArrayTraits<CTYPE>                           \
+    {                                                        \
+        static constexpr const char *name = #CLASS;          \
+        static bool isTypedArray(v8::Local<v8::Value> value) \
+        {                                                    \
+            return value->Is##CLASS();                       \
+        }                                                    \
+    };
+
+    IDA_TYPED_ARRAY_TRAITS(int8_t, Int8Array)
+    IDA_TYPED_ARRAY_TRAITS(uint8_t, Uint8Array)
+    IDA_TYPED_ARRAY_TRAITS(int16_t, Int16Array)
+    IDA_TYPED_ARRAY_TRAITS(uint16_t, Uint16Array)
+    IDA_TYPED_ARRAY_TRAITS(int32_t, Int32Array)
+    IDA_TYPED_ARRAY_TRAITS(uint32_t, Uint32Array)
+    IDA_TYPED_ARRAY_TRAITS(float, Float32Array)
+    IDA_TYPED_ARRAY_TRAITS(double, Float64Array)
+
+#undef IDA_TYPED_ARRAY_TRAITS
+
+    /// @brief Values of a validated array. For a typed array they point directly to its backing store, so they are
+    /// only valid until the callback returns and may be written to. A plain array is copied into the storage.
+    template <typename T>
+    struct ValidatedArray
+    {
+        bool isValid = false;
+        std::span<T> values;
+        std::vector<T> storage;
+    };
+
+    /// @brief Finds the lowest and the highest value. Branchless, so the compiler vectorizes the loop.
+    template <typename T>
+    std::pair<T, T> getValueRange(std::span<const T> values)
+    {
+        T lowest = values[0];
+        T highest = values[0];
+        for (T value : values)
+        {
+            lowest = value < lowest ? value : lowest;
+            highest = value > highest ? value : highest;
+        }
+        return {lowest, highest};
+    }
+
+    /// @brief Accepts the typed array matching T without copying it, falling back to inscope_validateArray for the
+    /// plain arrays
+    template <typename T, typename ValidatorFn, typename ExtractorFn>
+    ValidatedArray<T> inscope_validateTypedArray(const std::string &typeName, v8::Isolate *isolate,
+                                                 v8::Local<v8::Value> value, const std::string &argumentName,
+                                                 ValidatorFn isValid, ExtractorFn extract, size_t checkedSize,
+                                                 std::optional<T> minValue = std::nullopt,
+                                                 std::optional<T> maxValue = std::nullopt)
+    {
+        ValidatedArray<T> result;
+
+        if (!TypedArrayTraits<T>::isTypedArray(value))
+        {
+            if (!value->IsArray())
+            {
+                inscope_ThrowTypeError(isolate,
+                                       argumentName + " must be a " + TypedArrayTraits<T>::name + " or an array");
+                return result;
+            }
+
+            auto [isArrayValid, checkedValues] = inscope_validateArray<T>(typeName, isolate, value, argumentName,
+                                                                          isValid, extract, checkedSize, minValue,
+                                                                          maxValue);
+            result.isValid = isArrayValid;
+            result.storage = std::move(checkedValues);
+            result.values = std::span<T>(result.storage);
+            return result;
+        }
+
+        v8::Local<v8::TypedArray> typedArray = value.As<v8::TypedArray>();
+        size_t length = typedArray->Length();
+        if (checkedSize > 0 && length != checkedSize)
+        {
+            inscope_ThrowTypeError(isolate, argumentName + " must be an array of size " + std::to_string(checkedSize));
+            return result;
+        }
+
+        if (length > 0)
+        {
+            auto *data = static_cast<uint8_t *>(typedArray->Buffer()->Data()) + typedArray->ByteOffset();
+            result.values = std::span<T>(reinterpret_cast<T *>(data), length);
+
+            if (minValue || maxValue)
+            {
+                auto [lowest, highest] = getValueRange<T>(result.values);
+                if (minValue && lowest < *minValue)
+                {
+                    inscope_ThrowRangeError(
+                        isolate, argumentName + " must have values that are >= " + std::to_string(*minValue));
+                    return result;
+                }
+                if (maxValue && highest > *maxValue)
+                {
+                    inscope_ThrowRangeError(
+                        isolate, argumentName + " must have values that are <= " + std::to_string(*maxValue));
+                    return result;
+                }
+            }
+        }
+
+        result.isValid = true;
+        return result;
+    }
+
     std::pair<bool, std::string> inscope_validateString(v8::Isolate *isolate, v8::Local<v8::Value> value,
                                                         const std::string &argumentName, bool requireNonEmpty);
 
@@ -163,3 +280,14 @@ namespace core
         return;                                                                     \
     }                                                                               \
     auto name = result_##name.second;
+
+// Like VALIDATE_ARRAY, but name is a std::span<CTYPE> pointing into the matching typed array when one is passed
+#define VALIDATE_TYPED_ARRAY(CTYPE, SUFFIX, value, name, size, ...)                 \
+    auto result_##name = core::inscope_validateTypedArray<CTYPE>(                   \
+        #CTYPE, isolate, value, #name, [](auto v) { return v->Is##SUFFIX(); },      \
+        [](auto ctx, auto v) { return v->SUFFIX##Value(ctx); }, size, __VA_ARGS__); \
+    if (!result_##name.isValid)                                                     \
+    {                                                                               \
+        return;                                                                     \
+    }                                                                               \
+    auto name = result_##name.values;
@@ -2,70 +2,181 @@
 
 #include <libplatform/libplatform.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
 #include <string>
 
 #include "../../common/Logger.h"
 #include "../game/templates.h"
+#include "EmbedderSlots.h"
+#include "ModSession.h"
 #include "files.h"
 #include "library/Console.h"
 #include "library/Performance.h"
+#include "library/Profiler.h"
 #include "library/Require.h"
 #include "library/Timer.h"
+#include "runtime/CodeCache.h"
 #include "runtime/PromiseRejectionHandler.h"
+#include "runtime/StartupSnapshot.h"
 
 namespace core
 {
     using namespace Logger;
 
     static std::unique_ptr<v8::Platform> mPlatform;
-    static bool isInit = false;
-    static v8::Isolate *isolate = nullptr;
+    static Engine *defaultEngine = nullptr;
+    static RealTimeClock realTimeClock;
 
-    static PromiseRejectionHandler *promiseRejectionHandler = nullptr;
+    constexpr const char *HandleEventFunction = "_handleEvent";
+    constexpr const char *HandleEventsFunction = "_handleEvents";
+    constexpr const char *GlobalScriptPath = "global.js";
+    constexpr size_t Megabyte = 1024 * 1024;
 
-    // Setting it to bigger value will make timeouts more precise at the risk of delaying game frames
-    constexpr int MaxTasksPerFrame = 5;
+    // Depth of the nested inscope_tryCatch calls, e.g. a module required from a script
+    static thread_local int tryCatchDepth = 0;
 
-    constexpr const char *HandleEventFunction = "_handleEvent";
+    // A terminated script unwinds through all the JS frames, so the termination is only cancelled when the control is
+    // back in the host code, letting the later scripts and tasks run
+    static void inscope_cancelTermination(v8::Isolate *isolate)
+    {
+        if (tryCatchDepth == 0 && isolate->IsExecutionTerminating())
+        {
+            isolate->CancelTerminateExecution();
+        }
+    }
+
+    static void inscope_logException(v8::Isolate *isolate, v8::Local<v8::Message> message,
+                                     v8::Local<v8::Value> exceptionValue, v8::MaybeLocal<v8::Value> stackTrace)
+    {
+        v8::String::Utf8Value filename(isolate, message->GetScriptOrigin().ResourceName());
+        int line = message->GetLineNumber(isolate->GetCurrentContext()).FromMaybe(-1);
+        int column = message->GetStartColumn(isolate->GetCurrentContext()).FromMaybe(-1);
+        v8::String::Utf8Value exception(isolate, exceptionValue);
+        std::string errorMessage = *exception ? *exception : "Unknown exception";
+
+        std::string stackTraceOrMessage = errorMessage;
+        if (!stackTrace.IsEmpty())
+        {
+            v8::String::Utf8Value stackTraceStr(isolate, stackTrace.ToLocalChecked());
+            if (*stackTraceStr)
+            {
+                stackTraceOrMessage = *stackTraceStr;
+            }
+        }
+
+        err() << "Unhandled exception in " << (*filename ? *filename : "unknown script") << " on line " << line
+              << " column " << column << "\n"
+              << stackTraceOrMessage;
+    }
+
+    void inscope_reportException(v8::Local<v8::Value> exception)
+    {
+        v8::Isolate *isolate = v8::Isolate::GetCurrent();
+        inscope_logException(isolate, v8::Exception::CreateMessage(isolate, exception), exception,
+                             v8::TryCatch::StackTrace(isolate->GetCurrentContext(), exception));
+    }
 
     v8::MaybeLocal<v8::Value> inscope_tryCatch(const std::function<v8::MaybeLocal<v8::Value>()> &callback)
     {
+        v8::Isolate *isolate = v8::Isolate::GetCurrent();
         v8::TryCatch tryCatch(isolate);
+        tryCatchDepth++;
         auto result = callback();
+        tryCatchDepth--;
+        if (tryCatch.HasTerminated())
+        {
+            if (tryCatchDepth == 0)
+            {
+                err() << "Script execution was terminated";
+            }
+            inscope_cancelTermination(isolate);
+            return v8::MaybeLocal<v8::Value>();
+        }
         if (tryCatch.HasCaught())
         {
-            v8::Local<v8::Message> message = tryCatch.Message();
-            v8::String::Utf8Value filename(isolate, message->GetScriptOrigin().ResourceName());
-            int line = message->GetLineNumber(isolate->GetCurrentContext()).FromMaybe(-1);
-            int column = message->GetStartColumn(isolate->GetCurrentContext()).FromMaybe(-1);
-            v8::String::Utf8Value exception(isolate, tryCatch.Exception());
-            std::string errorMessage = *exception ? *exception : "Unknown exception";
+            inscope_logException(isolate, tryCatch.Message(), tryCatch.Exception(),
+                                 tryCatch.StackTrace(isolate->GetCurrentContext()));
+            return v8::MaybeLocal<v8::Value>();
+        }
+
+        return result;
+    }
 
-            std::string stackTraceOrMessage = errorMessage;
-            if (!tryCatch.StackTrace(isolate->GetCurrentContext()).IsEmpty())
+    static v8::Local<v8::ObjectTemplate> inscope_createGlobalTemplate(v8::Isolate *isolate)
+    {
+        v8::Local<v8::ObjectTemplate> global = v8::ObjectTemplate::New(isolate);
+        Console::inscope_bind(isolate, global);
+        Timer::inscope_bind(isolate, global);
+        Performance::inscope_bind(isolate, global);
+        Profiler::inscope_bind(isolate, global);
+        Require::inscope_bind(isolate, global);
+        return global;
+    }
+
+    static v8::MaybeLocal<v8::Value> inscope_runScriptWithCache(v8::Local<v8::Context> context,
+                                                                const std::string &scriptPath,
+                                                                const std::string &script, CodeCache *codeCache)
+    {
+        v8::Isolate *isolate = context->GetIsolate();
+
+        dbg() << "Loading " << scriptPath;
+
+        std::string scriptContents = script;
+
+        if (scriptContents.empty())
+        {
+            try
+            {
+                scriptContents = files::readAllText(scriptPath);
+            }
+            catch (std::exception &e)
+            {
+                std::cerr << "Error reading file: " << scriptPath << "; " << e.what() << "\n";
+                return v8::MaybeLocal<v8::Value>();
+            }
+        }
+
+        v8::Local<v8::String> source =
+            v8::String::NewFromUtf8(isolate, scriptContents.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
+
+        return inscope_tryCatch([&]() {
+            auto v8ScriptName = v8::String::NewFromUtf8(isolate, scriptPath.c_str()).ToLocalChecked();
+            v8::ScriptOrigin origin(v8ScriptName);
+            if (!codeCache)
             {
-                v8::Local<v8::Value> stackTraceValue =
-                    tryCatch.StackTrace(isolate->GetCurrentContext()).ToLocalChecked();
-                v8::String::Utf8Value stackTraceStr(isolate, stackTraceValue);
-                if (*stackTraceStr)
+                auto compileResult = v8::Script::Compile(context, source, &origin);
+                if (!compileResult.IsEmpty())
                 {
-                    stackTraceOrMessage = *stackTraceStr;
+                    auto script = compileResult.ToLocalChecked();
+                    return script->Run(context);
                 }
+                return v8::MaybeLocal<v8::Value>();
             }
 
-            err() << "Unhandled exception in " << (*filename ? *filename : "unknown script") << " on line " << line
-                  << " column " << column << "\n"
-                  << stackTraceOrMessage;
-
-            return v8::MaybeLocal<v8::Value>();
-        }
+            auto cachedScript = codeCache->inscope_compile(context, source, origin, scriptContents);
+            v8::Local<v8::Script> script;
+            if (!cachedScript.script.ToLocal(&script))
+            {
+                return v8::MaybeLocal<v8::Value>();
+            }
 
-        return result;
+            auto runResult = script->Run(context);
+            if (!runResult.IsEmpty() && !cachedScript.isCacheHit)
+            {
+                codeCache->inscope_store(script, cachedScript.cacheKey);
+            }
+            return runResult;
+        });
     }
 
-    void initV8(char *appLocation)
+    // ***** Engine *****
+
+    void Engine::initPlatform(char *appLocation)
     {
-        if (isInit)
+        if (mPlatform)
         {
             return;
         }
@@ -75,98 +186,325 @@ namespace core
         mPlatform = v8::platform::NewDefaultPlatform();
         v8::V8::InitializePlatform(mPlatform.get());
         v8::V8::Initialize();
+    }
+
+    void Engine::disposePlatform()
+    {
+        if (!mPlatform)
+        {
+            return;
+        }
+
+        v8::V8::Dispose();
+        v8::V8::DisposePlatform();
+        mPlatform.reset();
+    }
+
+    bool Engine::isPlatformInit()
+    {
+        return mPlatform != nullptr;
+    }
+
+    Engine::Engine(const InitOptions &options)
+    {
+        if (!mPlatform)
+        {
+            throw std::logic_error("V8 platform is not initialized");
+        }
+
+        mArrayBufferAllocator = std::make_unique<PooledAllocator>(options.arrayBufferPoolMb * Megabyte);
+        mDiagnosticsDir = files::toAbsolute("diagnostics");
 
         v8::Isolate::CreateParams create_params;
-        create_params.array_buffer_allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
+        create_params.array_buffer_allocator = mArrayBufferAllocator.get();
+        create_params.external_references = StartupSnapshot::getExternalReferences();
+
+        if (options.maxOldGenerationSizeMb > 0)
+        {
+            create_params.constraints.set_max_old_generation_size_in_bytes(options.maxOldGenerationSizeMb * Megabyte);
+        }
+        if (options.maxYoungGenerationSizeMb > 0)
+        {
+            create_params.constraints.set_max_young_generation_size_in_bytes(options.maxYoungGenerationSizeMb *
+                                                                             Megabyte);
+        }
+
+        if (!options.snapshotBlobPath.empty())
+        {
+            mStartupSnapshot = std::make_unique<StartupSnapshot>();
+            if (mStartupSnapshot->load(options.snapshotBlobPath))
+            {
+                create_params.snapshot_blob = mStartupSnapshot->getStartupData();
+            }
+            else
+            {
+                mStartupSnapshot.reset();
+            }
+        }
 
-        isolate = v8::Isolate::New(create_params);
-        isolate->SetMicrotasksPolicy(v8::MicrotasksPolicy::kExplicit);
+        mIsolate = v8::Isolate::New(create_params);
+        mIsolate->SetMicrotasksPolicy(v8::MicrotasksPolicy::kExplicit);
+        setClock(nullptr);
+        mIsolate->SetData(static_cast<uint32_t>(IsolateSlot::Engine), this);
 
-        promiseRejectionHandler = new PromiseRejectionHandler(isolate);
+        mNearHeapLimitAction = options.nearHeapLimitAction;
+        mIsolate->AddNearHeapLimitCallback(onNearHeapLimit, this);
 
-        isInit = true;
+        mPromiseRejectionHandler = std::make_unique<PromiseRejectionHandler>(mIsolate);
+        mCpuProfileRecorder = std::make_unique<CpuProfileRecorder>(mIsolate);
     }
 
-    bool isV8Init()
+    Engine::~Engine()
     {
-        return isInit;
+        mTaskQueue.clear();
+        mTimerScheduler.clear();
+        mPromiseRejectionHandler.reset();
+        mCodeCache.reset();
+        mCpuProfileRecorder.reset();
+
+        mIsolate->Dispose();
+
+        // The snapshot blob and the allocator must outlive the isolate
+        mStartupSnapshot.reset();
+        mArrayBufferAllocator.reset();
     }
 
-    v8::Isolate *getIsolate()
+    Engine *Engine::fromIsolate(v8::Isolate *isolate)
     {
-        return isolate;
+        return isolate ? static_cast<Engine *>(isolate->GetData(static_cast<uint32_t>(IsolateSlot::Engine))) : nullptr;
     }
 
-    bool runModScript(std::string &scriptFullPath, BindObjectsCallback bindObjectsCallback, RunCallback callback)
+    size_t Engine::onNearHeapLimit(void *data, size_t currentHeapLimit, size_t initialHeapLimit)
+    {
+        Engine *engine = static_cast<Engine *>(data);
+        v8::Isolate *isolate = engine->mIsolate;
+
+        v8::HeapStatistics heapStatistics;
+        isolate->GetHeapStatistics(&heapStatistics);
+        err() << "JS heap is near its limit: used " << heapStatistics.used_heap_size() / 1024 << " KB, total "
+              << heapStatistics.total_heap_size() / 1024 << " KB, limit " << currentHeapLimit / 1024 << " KB";
+
+        if (engine->mNearHeapLimitAction == NearHeapLimitAction::Terminate)
+        {
+            err() << "Terminating the running script";
+            isolate->TerminateExecution();
+        }
+
+        // The initial limit is restored once the heap shrinks back, e.g. after the terminated script is collected
+        isolate->AutomaticallyRestoreInitialHeapLimit();
+        return currentHeapLimit + initialHeapLimit / 4;
+    }
+
+    // Called from any thread: nothing else of the isolate or the engine may be touched here
+    void Engine::notifyMemoryPressure(v8::MemoryPressureLevel level)
     {
-        if (!isInit)
+        if (mMemoryPressureLevel.exchange(level) != level)
         {
-            return false;
+            mIsolate->MemoryPressureNotification(level);
+            if (level == v8::MemoryPressureLevel::kCritical)
+            {
+                mArrayBufferAllocator->trim();
+            }
         }
+    }
+
+    void Engine::notifyLowMemory()
+    {
+        v8::Isolate::Scope isolateScope(mIsolate);
+        mIsolate->LowMemoryNotification();
+        mArrayBufferAllocator->trim();
+    }
+
+    v8::Local<v8::FunctionTemplate> Engine::inscope_getClassTemplate(const void *classKey)
+    {
+        auto found = mClassTemplates.find(classKey);
+        return found != mClassTemplates.end() ? found->second.Get(mIsolate) : v8::Local<v8::FunctionTemplate>();
+    }
+
+    void Engine::inscope_setClassTemplate(const void *classKey, v8::Local<v8::FunctionTemplate> classTemplate)
+    {
+        mClassTemplates.insert_or_assign(classKey, v8::Eternal<v8::FunctionTemplate>(mIsolate, classTemplate));
+    }
+
+    ArrayBufferStats Engine::getArrayBufferStats()
+    {
+        return mArrayBufferAllocator->sampleStats();
+    }
+
+    void Engine::trimArrayBufferPool(size_t retainedBytes)
+    {
+        mArrayBufferAllocator->trim(retainedBytes);
+    }
+
+    bool Engine::startCpuProfile(int samplingIntervalMicros)
+    {
+        return mCpuProfileRecorder->start(samplingIntervalMicros);
+    }
+
+    bool Engine::stopCpuProfile(const std::string &filePath, CpuProfileFormat format)
+    {
+        return mCpuProfileRecorder->stop(filePath, format);
+    }
+
+    bool Engine::isCpuProfiling() const
+    {
+        return mCpuProfileRecorder->isRecording();
+    }
+
+    HeapStats Engine::getHeapStats() const
+    {
+        return sampleHeapStats(mIsolate);
+    }
+
+    bool Engine::writeHeapSnapshot(const std::string &filePath)
+    {
+        return core::writeHeapSnapshot(mIsolate, filePath);
+    }
+
+    void Engine::setCodeCacheDir(const std::string &cacheDirPath)
+    {
+        mCodeCache = cacheDirPath.empty() ? nullptr : std::make_unique<CodeCache>(cacheDirPath);
+    }
+
+    std::string Engine::resolveDiagnosticsPath(const std::string &relativePath) const
+    {
+        if (mDiagnosticsDir.empty())
+        {
+            return "";
+        }
+
+        std::string unixPath = relativePath;
+        std::replace(unixPath.begin(), unixPath.end(), '\\', '/');
+        std::filesystem::path path(unixPath);
+        if (path.empty() || path.has_root_name() || path.has_root_directory())
+        {
+            return "";
+        }
+        for (const std::filesystem::path &part : path)
+        {
+            if (part == "..")
+            {
+                return "";
+            }
+        }
+
+        std::filesystem::path fullPath = std::filesystem::path(mDiagnosticsDir) / path;
+        files::createDirectories(fullPath.parent_path().string());
+        return fullPath.string();
+    }
+
+    std::unique_ptr<ModSession> Engine::createSession(const std::string &scriptFullPath,
+                                                      BindObjectsCallback bindObjectsCallback)
+    {
+        v8::Isolate *isolate = mIsolate;
+        std::unique_ptr<ModSession> session(new ModSession(this, scriptFullPath));
 
         // Scopes
         v8::Isolate::Scope isolateScope(isolate);
-        v8::HandleScope mainScope(isolate);
+        v8::HandleScope handleScope(isolate);
 
-        // Binding host objects
-        Console console;
-        Timer timer;
-        Performance performance;
-        Require require;
-        v8::Local<v8::ObjectTemplate> global = v8::ObjectTemplate::New(isolate);
-        console.inscope_bind(isolate, global);
-        timer.inscope_bind(isolate, global);
-        performance.inscope_bind(isolate, global);
-        require.inscope_bind(isolate, global);
+        // Create a new context, deserializing the bootstrapped one if there is a startup snapshot
+        v8::Local<v8::Context> context;
+        bool isBootstrapped =
+            mStartupSnapshot && v8::Context::FromSnapshot(isolate, BootstrappedContextIndex).ToLocal(&context);
+        if (!isBootstrapped)
+        {
+            context = v8::Context::New(isolate, nullptr, inscope_createGlobalTemplate(isolate));
+        }
 
-        // Create a new context
-        v8::Local<v8::Context> context = v8::Context::New(isolate, nullptr, global);
+        // Binding host objects
+        session->mContext.Reset(isolate, context);
+        session->mTimer.inscope_attach(context);
+        session->mRequire.inscope_attach(context);
 
         // Enter the context scope for compiling and running the main script
         v8::Context::Scope context_scope(context);
+        v8::Local<v8::Object> globalObject = context->Global();
+        Console::inscope_bindConsole(context);
+
+        // Add modScriptPath to the global object
+        v8::Local<v8::String> scriptPathKey = v8::String::NewFromUtf8(isolate, "modScriptPath").ToLocalChecked();
+        v8::Local<v8::String> scriptPathValue =
+            v8::String::NewFromUtf8(isolate, scriptFullPath.c_str()).ToLocalChecked();
+        globalObject->Set(context, scriptPathKey, scriptPathValue).Check();
+
+        // Binding client objects
+        session->mClientObjects = bindObjectsCallback();
+        session->mClientObjects->init(isolate, globalObject);
+
+        // The bootstrapped context has already run the global script
+        if (!isBootstrapped && inscope_runScript(context, GlobalScriptPath).IsEmpty())
         {
-            v8::Local<v8::Object> globalObject = context->Global();
+            std::cerr << "JS compile error: Failed to load global script\n";
+            return nullptr;
+        }
 
-            // Add modScriptPath to the global object
-            v8::Local<v8::String> scriptPathKey = v8::String::NewFromUtf8(isolate, "modScriptPath").ToLocalChecked();
-            v8::Local<v8::String> scriptPathValue =
-                v8::String::NewFromUtf8(isolate, scriptFullPath.c_str()).ToLocalChecked();
-            globalObject->Set(context, scriptPathKey, scriptPathValue).Check();
+        return session;
+    }
 
-            // Binding client objects
-            auto clientObjects = bindObjectsCallback();
-            clientObjects->init(isolate, globalObject);
+    void Engine::setJsLogLevel(Logger::LogLevel level)
+    {
+        mJsLogLevel = level;
 
-            try
-            {
-                std::string globalScriptPath = "global.js";
-                auto globalScriptResult = inscope_runScript(context, globalScriptPath);
-                if (globalScriptResult.IsEmpty())
-                {
-                    throw std::logic_error("Failed to load global script");
-                }
-            }
-            catch (std::logic_error &e)
+        v8::Isolate::Scope isolateScope(mIsolate);
+        v8::HandleScope handleScope(mIsolate);
+        for (ModSession *session : mSessions)
+        {
+            // Empty while the session is being created, its console is bound after the context is set
+            if (session->mContext.IsEmpty())
             {
-                std::cerr << "JS compile error: " << e.what() << "\n";
-                return false;
+                continue;
             }
 
-            callback();
-
-            return true;
+            v8::Local<v8::Context> context = session->mContext.Get(mIsolate);
+            v8::Context::Scope contextScope(context);
+            Console::inscope_bindConsole(context);
         }
     }
 
-    void runSyncEvent(const std::string &eventName, const ObjectProviderCallback objectProvider,
-                      const ArgumentsProviderCallback argumentsProvider)
+    bool Engine::runModScript(std::string &scriptFullPath, BindObjectsCallback bindObjectsCallback,
+                              RunCallback callback)
     {
-        if (!isInit)
+        std::unique_ptr<ModSession> session = createSession(scriptFullPath, bindObjectsCallback);
+        if (!session)
         {
-            return;
+            return false;
         }
 
+        // The session active before is active again when leaving, also by an exception of the callback, so the tasks
+        // posted afterwards belong to it
+        struct ActiveSessionRestorer
+        {
+            Engine *engine;
+            ModSession *previousSession;
+
+            ~ActiveSessionRestorer()
+            {
+                if (previousSession)
+                {
+                    previousSession->activate();
+                }
+                else if (ModSession *activeSession = engine->getActiveSession())
+                {
+                    activeSession->deactivate();
+                }
+            }
+        } activeSessionRestorer{this, mActiveSession};
+
+        // The handle scope is kept for the callback, which may create handles without its own scope
+        v8::Isolate::Scope isolateScope(mIsolate);
+        v8::HandleScope mainScope(mIsolate);
+        session->activate();
+        callback();
+
+        return true;
+    }
+
+    void Engine::runSyncEvent(const std::string &eventName, const ObjectProviderCallback objectProvider,
+                              const ArgumentsProviderCallback argumentsProvider)
+    {
         using namespace v8;
+        Isolate *isolate = mIsolate;
         HandleScope scope(isolate);
 
         Local<Context> ctx = isolate->GetCurrentContext();
@@ -175,81 +513,161 @@ namespace core
 
         std::vector<Local<Value>> functionArgs;
         functionArgs.reserve(1 + userArgs.size());
-        functionArgs.push_back(
-            String::NewFromUtf8(isolate, eventName.c_str(), NewStringType::kNormal).ToLocalChecked());
+        functionArgs.push_back(inscope_getEventName(eventName));
         functionArgs.insert(functionArgs.end(), userArgs.begin(), userArgs.end());
 
-        inscope_runFunction(std::string(HandleEventFunction), true, &functionArgs, objectProvider);
+        int64_t startMicros = LatencyRecorder::now();
+        MaybeLocal<Value> result =
+            inscope_runFunction(std::string(HandleEventFunction), true, &functionArgs, objectProvider);
+        mLatencyRecorder.record(LatencyCategory::Event, eventName, startMicros, result.IsEmpty());
     }
 
-    void runFunction(const std::string &functionName, bool requireFunction, const ObjectProviderCallback objectProvider,
-                     const ArgumentsProviderCallback args, const ResultCallback resultCallback)
+    void Engine::runSyncEvents(std::span<const EventRecord> events, const ObjectProviderCallback objectProvider)
     {
-        if (!isInit)
+        using namespace v8;
+        Isolate *isolate = mIsolate;
+        HandleScope scope(isolate);
+
+        if (events.empty())
         {
             return;
         }
 
-        using namespace v8;
-        HandleScope scope(isolate);
+        Local<Context> ctx = isolate->GetCurrentContext();
+        Local<Object> object = objectProvider ? objectProvider(ctx) : ctx->Global();
 
-        MaybeLocal<Value> result =
-            inscope_runFunction(functionName, requireFunction, args ? &args(isolate) : nullptr, objectProvider);
+        // The object may have its own batch handler, otherwise the default one from global.js is used with the object
+        // as this
+        Local<String> batchHandlerName = inscope_getEventName(HandleEventsFunction);
+        Local<Value> batchHandler;
+        if (!object->Get(ctx, batchHandlerName).ToLocal(&batchHandler) || !batchHandler->IsFunction())
+        {
+            if (!ctx->Global()->Get(ctx, batchHandlerName).ToLocal(&batchHandler) || !batchHandler->IsFunction())
+            {
+                std::cerr << "Function '" << HandleEventsFunction
+                          << "' not found, delivering the events one by one." << std::endl;
+                for (const EventRecord &event : events)
+                {
+                    runSyncEvent(std::string(event.eventName), objectProvider, event.argumentsProvider);
+                }
+                return;
+            }
+        }
 
-        if (resultCallback)
+        std::vector<Local<Value>> batch;
+        batch.reserve(events.size());
+        std::vector<Local<Value>> eventValues;
+        for (const EventRecord &event : events)
         {
-            resultCallback(isolate, result);
+            eventValues.clear();
+            eventValues.push_back(inscope_getEventName(event.eventName));
+            if (event.argumentsProvider)
+            {
+                std::vector<Local<Value>> userArgs = event.argumentsProvider(isolate);
+                eventValues.insert(eventValues.end(), userArgs.begin(), userArgs.end());
+            }
+            batch.push_back(Array::New(isolate, eventValues.data(), eventValues.size()));
+        }
+
+        // When recording, the handler writes the end time of each event on the clock of the recorder, negated if
+        // the event threw, so each event is recorded under its own name
+        bool isRecording = mLatencyRecorder.isEnabled();
+        Local<ArrayBuffer> endTimesBuffer;
+        Local<Value> argv[] = {Array::New(isolate, batch.data(), batch.size()), Undefined(isolate)};
+        if (isRecording)
+        {
+            endTimesBuffer = ArrayBuffer::New(isolate, events.size() * sizeof(double));
+            argv[1] = Float64Array::New(endTimesBuffer, 0, events.size());
+        }
+
+        Local<Function> batchFunction = batchHandler.As<Function>();
+        int64_t startMicros = isRecording ? LatencyRecorder::now() : 0;
+        MaybeLocal<Value> result = inscope_tryCatch([&]() { return batchFunction->Call(ctx, object, 2, argv); });
+        if (isRecording)
+        {
+            inscope_recordBatchLatencies(events, endTimesBuffer, startMicros, result.IsEmpty());
         }
     }
 
-    v8::MaybeLocal<v8::Value> inscope_runScript(v8::Local<v8::Context> context, const std::string &scriptPath,
-                                                const std::string &script)
+    void Engine::inscope_recordBatchLatencies(std::span<const EventRecord> events,
+                                              v8::Local<v8::ArrayBuffer> endTimesBuffer, int64_t startMicros,
+                                              bool threw)
     {
-        if (!isInit)
+        // A custom handler may ignore or detach the end times, then only the whole batch is recorded
+        auto endTimes = static_cast<const double *>(endTimesBuffer->Data());
+        if (!endTimes || endTimesBuffer->ByteLength() < events.size() * sizeof(double) || endTimes[0] == 0)
         {
-            throw std::runtime_error("V8 is not initialized");
+            mLatencyRecorder.record(LatencyCategory::Function, HandleEventsFunction, startMicros, threw);
+            return;
         }
 
-        dbg() << "Loading " << scriptPath;
+        int64_t previousMicros = startMicros;
+        size_t index = 0;
+        for (; index < events.size() && endTimes[index] != 0; index++)
+        {
+            int64_t endMicros = static_cast<int64_t>(std::abs(endTimes[index]));
+            mLatencyRecorder.getHistogram(LatencyCategory::Event, events[index].eventName)
+                .record(endMicros - previousMicros, endTimes[index] < 0);
+            previousMicros = endMicros;
+        }
 
-        std::string scriptContents = script;
+        // The event interrupted by a termination
+        if (threw && index < events.size())
+        {
+            mLatencyRecorder.record(LatencyCategory::Event, events[index].eventName, previousMicros, true);
+        }
+    }
 
-        if (scriptContents.empty())
+    v8::Local<v8::String> Engine::inscope_getEventName(std::string_view eventName)
+    {
+        auto cached = mEventNames.find(eventName);
+        if (cached != mEventNames.end())
         {
-            try
-            {
-                scriptContents = files::readAllText(scriptPath);
-            }
-            catch (std::exception &e)
-            {
-                std::cerr << "Error reading file: " << scriptPath << "; " << e.what() << "\n";
-                return v8::MaybeLocal<v8::Value>();
-            }
+            return cached->second.Get(mIsolate);
         }
 
-        v8::Local<v8::String> source =
-            v8::String::NewFromUtf8(isolate, scriptContents.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
+        v8::Local<v8::String> name =
+            v8::String::NewFromUtf8(mIsolate, eventName.data(), v8::NewStringType::kInternalized,
+                                    static_cast<int>(eventName.size()))
+                .ToLocalChecked();
+        mEventNames.emplace(std::string(eventName), v8::Eternal<v8::String>(mIsolate, name));
+        return name;
+    }
 
-        return inscope_tryCatch([&]() {
-            auto v8ScriptName = v8::String::NewFromUtf8(isolate, scriptPath.c_str()).ToLocalChecked();
-            v8::ScriptOrigin origin(v8ScriptName);
-            auto compileResult = v8::Script::Compile(context, source, &origin);
-            if (!compileResult.IsEmpty())
-            {
-                auto script = compileResult.ToLocalChecked();
-                return script->Run(context);
-            }
-            return v8::MaybeLocal<v8::Value>();
-        });
+    void Engine::runFunction(const std::string &functionName, bool requireFunction,
+                             const ObjectProviderCallback objectProvider, const ArgumentsProviderCallback args,
+                             const ResultCallback resultCallback)
+    {
+        using namespace v8;
+        HandleScope scope(mIsolate);
+
+        MaybeLocal<Value> result =
+            inscope_runFunction(functionName, requireFunction, args ? &args(mIsolate) : nullptr, objectProvider);
+
+        if (resultCallback)
+        {
+            resultCallback(mIsolate, result);
+        }
     }
 
-    v8::MaybeLocal<v8::Value> inscope_runFunction(const std::string &functionName, bool requireFunction,
-                                                  std::vector<v8::Local<v8::Value>> *args,
-                                                  const ObjectProviderCallback objectProvider)
+    v8::MaybeLocal<v8::Value> Engine::inscope_runScript(v8::Local<v8::Context> context, const std::string &scriptPath,
+                                                        const std::string &script)
     {
-        auto gameContext = isolate->GetCurrentContext();
+        return inscope_runScriptWithCache(context, scriptPath, script, mCodeCache.get());
+    }
+
+    HostBuffer Engine::inscope_createHostBuffer(void *data, size_t byteLength, HostBufferReleaseCallback onReleased)
+    {
+        return HostBuffer::inscope_create(mIsolate, data, byteLength, std::move(onReleased));
+    }
+
+    v8::MaybeLocal<v8::Value> Engine::inscope_runFunction(const std::string &functionName, bool requireFunction,
+                                                          std::vector<v8::Local<v8::Value>> *args,
+                                                          const ObjectProviderCallback objectProvider)
+    {
+        auto gameContext = mIsolate->GetCurrentContext();
         auto object = objectProvider ? objectProvider(gameContext) : gameContext->Global();
-        auto funcName = v8::String::NewFromUtf8(isolate, functionName.c_str()).ToLocalChecked();
+        auto funcName = v8::String::NewFromUtf8(mIsolate, functionName.c_str()).ToLocalChecked();
         auto funcVal = object->Get(gameContext, funcName).ToLocalChecked();
 
         if (funcVal->IsFunction())
@@ -262,7 +680,11 @@ namespace core
                 argc = args->size();
                 argv = args->data();
             }
-            return inscope_tryCatch([&]() { return func->Call(gameContext, object, argc, argv); });
+            int64_t startMicros = LatencyRecorder::now();
+            v8::MaybeLocal<v8::Value> result =
+                inscope_tryCatch([&]() { return func->Call(gameContext, object, argc, argv); });
+            mLatencyRecorder.record(LatencyCategory::Function, functionName, startMicros, result.IsEmpty());
+            return result;
         }
         else if (requireFunction)
         {
@@ -272,6 +694,321 @@ namespace core
         return v8::MaybeLocal<v8::Value>();
     }
 
+    FunctionHandle Engine::inscope_resolveFunction(const std::string &functionName,
+                                                   const ObjectProviderCallback objectProvider)
+    {
+        auto gameContext = mIsolate->GetCurrentContext();
+        auto object = objectProvider ? objectProvider(gameContext) : gameContext->Global();
+        return FunctionHandle::inscope_resolve(mIsolate, object, functionName);
+    }
+
+    void Engine::runFunction(const FunctionHandle &function, const ArgumentsProviderCallback args,
+                             const ResultCallback resultCallback)
+    {
+        using namespace v8;
+        HandleScope scope(mIsolate);
+
+        MaybeLocal<Value> result;
+        if (function.inscope_isValid())
+        {
+            std::vector<Local<Value>> argv = args ? args(mIsolate) : std::vector<Local<Value>>();
+            int64_t startMicros = LatencyRecorder::now();
+            result = function.inscope_call(static_cast<int>(argv.size()), argv.data());
+            mLatencyRecorder.record(LatencyCategory::Function, function.getName(), startMicros, result.IsEmpty());
+        }
+        else
+        {
+            std::cerr << "Function '" << function.getName() << "' was reassigned or is not callable." << std::endl;
+        }
+
+        if (resultCallback)
+        {
+            resultCallback(mIsolate, result);
+        }
+    }
+
+    void Engine::setClock(Clock *clock)
+    {
+        mClock = clock ? clock : &realTimeClock;
+        mTimeOrigin = mClock->now();
+    }
+
+    double Engine::getTime() const
+    {
+        return mClock->now();
+    }
+
+    double Engine::getNextDeadline() const
+    {
+        return std::min(mTimerScheduler.getNextDeadline(), mTaskQueue.getNextDeadline());
+    }
+
+    void Engine::postTask(v8::Task *task, const void *owner)
+    {
+        mTaskQueue.post(std::unique_ptr<v8::Task>(task), getTime(), owner);
+    }
+
+    void Engine::postDelayedTask(v8::Task *task, double delay, const void *owner)
+    {
+        mTaskQueue.postDelayed(std::unique_ptr<v8::Task>(task), getTime(), delay, owner);
+    }
+
+    void Engine::cancelTasks(const void *owner)
+    {
+        mTaskQueue.cancel(owner);
+    }
+
+    TaskPumpStats Engine::processTasks(int64_t budgetMicros)
+    {
+        using namespace std::chrono;
+
+        TaskPumpStats stats;
+        auto startTime = steady_clock::now();
+        auto getElapsedMicros = [&startTime]() {
+            return duration_cast<microseconds>(steady_clock::now() - startTime).count();
+        };
+
+        mIsolate->PerformMicrotaskCheckpoint();
+        mPromiseRejectionHandler->checkUnhandledRejections();
+
+        // Engine tasks: timers and the tasks posted by the host and the library objects, ordered by deadline
+        while (true)
+        {
+            double now = getTime();
+            double timerDeadline = mTimerScheduler.getNextDeadline();
+            if (timerDeadline <= now && timerDeadline < mTaskQueue.getNextReadyDeadline(mTaskPolicy, now))
+            {
+                mTimerScheduler.runNext(now);
+            }
+            else if (std::unique_ptr<v8::Task> task = mTaskQueue.popReady(mTaskPolicy, now))
+            {
+                task->Run();
+            }
+            else
+            {
+                break;
+            }
+
+            inscope_cancelTermination(mIsolate);
+            mIsolate->PerformMicrotaskCheckpoint();
+            mPromiseRejectionHandler->checkUnhandledRejections();
+            stats.tasksRun++;
+
+            if (getElapsedMicros() >= budgetMicros)
+            {
+                break;
+            }
+        }
+
+        // V8 internal tasks, posted directly to the platform
+        while (getElapsedMicros() < budgetMicros && v8::platform::PumpMessageLoop(mPlatform.get(), mIsolate))
+        {
+            mIsolate->PerformMicrotaskCheckpoint();
+            mPromiseRejectionHandler->checkUnhandledRejections();
+            stats.tasksRun++;
+        }
+
+        double now = getTime();
+        stats.tasksDeferred = static_cast<int>(mTaskQueue.countReady(now) + mTimerScheduler.countDue(now));
+        stats.elapsedMicros = getElapsedMicros();
+        return stats;
+    }
+
+    // ***** Default engine *****
+
+    // Engine of the isolate the calling code runs in, falling back to the default one
+    static Engine *inscope_getCurrentEngine()
+    {
+        Engine *engine = Engine::fromIsolate(v8::Isolate::GetCurrent());
+        return engine ? engine : defaultEngine;
+    }
+
+    void initV8(char *appLocation, const InitOptions &options)
+    {
+        if (defaultEngine)
+        {
+            return;
+        }
+
+        Engine::initPlatform(appLocation);
+        defaultEngine = new Engine(options);
+    }
+
+    Engine *getDefaultEngine()
+    {
+        return defaultEngine;
+    }
+
+    bool isV8Init()
+    {
+        return defaultEngine != nullptr;
+    }
+
+    v8::Isolate *getIsolate()
+    {
+        return defaultEngine ? defaultEngine->getIsolate() : nullptr;
+    }
+
+    void setCodeCacheDir(const std::string &cacheDirPath)
+    {
+        if (defaultEngine)
+        {
+            defaultEngine->setCodeCacheDir(cacheDirPath);
+        }
+    }
+
+    void setDiagnosticsDir(const std::string &dirPath)
+    {
+        if (defaultEngine)
+        {
+            defaultEngine->setDiagnosticsDir(dirPath);
+        }
+    }
+
+    void setJsLogLevel(Logger::LogLevel level)
+    {
+        // Also kept for a default engine created again later
+        Logger::setJsLogLevel(level);
+        if (defaultEngine)
+        {
+            defaultEngine->setJsLogLevel(level);
+        }
+    }
+
+    bool createStartupSnapshot(const std::string &blobPath)
+    {
+        if (!Engine::isPlatformInit())
+        {
+            return false;
+        }
+
+        std::unique_ptr<v8::ArrayBuffer::Allocator> allocator(v8::ArrayBuffer::Allocator::NewDefaultAllocator());
+        v8::Isolate::CreateParams createParams;
+        createParams.array_buffer_allocator = allocator.get();
+        createParams.external_references = StartupSnapshot::getExternalReferences();
+
+        bool isBootstrapped = false;
+        v8::StartupData blob;
+        {
+            v8::SnapshotCreator snapshotCreator(createParams);
+            v8::Isolate *snapshotIsolate = snapshotCreator.GetIsolate();
+            {
+                v8::HandleScope handleScope(snapshotIsolate);
+                snapshotCreator.SetDefaultContext(v8::Context::New(snapshotIsolate));
+
+                v8::Local<v8::Context> context =
+                    v8::Context::New(snapshotIsolate, nullptr, inscope_createGlobalTemplate(snapshotIsolate));
+                {
+                    // The embedder slots are set so a timer or a require in global.js throws instead of crashing
+                    v8::Context::Scope contextScope(context);
+                    Timer::inscope_detach(context);
+                    Require::inscope_detach(context);
+                    isBootstrapped = !inscope_runScriptWithCache(context, GlobalScriptPath, "", nullptr).IsEmpty();
+                }
+
+                if (isBootstrapped)
+                {
+                    snapshotCreator.AddContext(context);
+                }
+            }
+
+            // The blob has to be created even on failure, before the creator is destroyed
+            blob = snapshotCreator.CreateBlob(v8::SnapshotCreator::FunctionCodeHandling::kClear);
+        }
+
+        bool isSaved = isBootstrapped && StartupSnapshot::save(blob, blobPath);
+        delete[] blob.data;
+
+        if (!isBootstrapped)
+        {
+            err() << "Failed to create startup snapshot: " << GlobalScriptPath << " could not be loaded";
+        }
+
+        return isSaved;
+    }
+
+    bool runModScript(std::string &scriptFullPath, BindObjectsCallback bindObjectsCallback, RunCallback callback)
+    {
+        if (!defaultEngine)
+        {
+            return false;
+        }
+
+        return defaultEngine->runModScript(scriptFullPath, bindObjectsCallback, callback);
+    }
+
+    void runSyncEvent(const std::string &eventName, const ObjectProviderCallback objectProvider,
+                      const ArgumentsProviderCallback argumentsProvider)
+    {
+        if (!defaultEngine)
+        {
+            return;
+        }
+
+        defaultEngine->runSyncEvent(eventName, objectProvider, argumentsProvider);
+    }
+
+    void runSyncEvents(std::span<const EventRecord> events, const ObjectProviderCallback objectProvider)
+    {
+        if (!defaultEngine)
+        {
+            return;
+        }
+
+        defaultEngine->runSyncEvents(events, objectProvider);
+    }
+
+    void runFunction(const std::string &functionName, bool requireFunction, const ObjectProviderCallback objectProvider,
+                     const ArgumentsProviderCallback args, const ResultCallback resultCallback)
+    {
+        if (!defaultEngine)
+        {
+            return;
+        }
+
+        defaultEngine->runFunction(functionName, requireFunction, objectProvider, args, resultCallback);
+    }
+
+    v8::MaybeLocal<v8::Value> inscope_runScript(v8::Local<v8::Context> context, const std::string &scriptPath,
+                                                const std::string &script)
+    {
+        Engine *engine = Engine::fromIsolate(context->GetIsolate());
+        if (!engine)
+        {
+            throw std::runtime_error("V8 is not initialized");
+        }
+
+        return engine->inscope_runScript(context, scriptPath, script);
+    }
+
+    v8::MaybeLocal<v8::Value> inscope_runFunction(const std::string &functionName, bool requireFunction,
+                                                  std::vector<v8::Local<v8::Value>> *args,
+                                                  const ObjectProviderCallback objectProvider)
+    {
+        return inscope_getCurrentEngine()->inscope_runFunction(functionName, requireFunction, args, objectProvider);
+    }
+
+    FunctionHandle inscope_resolveFunction(const std::string &functionName, const ObjectProviderCallback objectProvider)
+    {
+        return inscope_getCurrentEngine()->inscope_resolveFunction(functionName, objectProvider);
+    }
+
+    HostBuffer inscope_createHostBuffer(void *data, size_t byteLength, HostBufferReleaseCallback onReleased)
+    {
+        return inscope_getCurrentEngine()->inscope_createHostBuffer(data, byteLength, std::move(onReleased));
+    }
+
+    void runFunction(const FunctionHandle &function, const ArgumentsProviderCallback args,
+                     const ResultCallback resultCallback)
+    {
+        if (!defaultEngine)
+        {
+            return;
+        }
+
+        defaultEngine->runFunction(function, args, resultCallback);
+    }
+
     v8::Local<v8::Object> inscope_GetObject(v8::Local<v8::Context> context, const char *objectName)
     {
         v8::Local<v8::Object> global = context->Global();
@@ -283,55 +1020,90 @@ namespace core
 
     void postTask(v8::Task *task)
     {
-        if (!isInit)
+        Engine *engine = inscope_getCurrentEngine();
+        if (!engine)
         {
             return;
         }
 
-        mPlatform->GetForegroundTaskRunner(isolate)->PostTask(std::unique_ptr<v8::Task>(task));
+        engine->postTask(task, engine->getActiveSession());
     }
 
     void postDelayedTask(v8::Task *task, double delay)
     {
-        if (!isInit)
+        Engine *engine = inscope_getCurrentEngine();
+        if (!engine)
         {
             return;
         }
 
-        mPlatform->GetForegroundTaskRunner(isolate)->PostDelayedTask(std::unique_ptr<v8::Task>(task), delay);
+        engine->postDelayedTask(task, delay, engine->getActiveSession());
     }
 
-    void processTasks()
+    TaskPumpStats processTasks(int64_t budgetMicros)
     {
-        if (!isInit)
+        if (!defaultEngine)
         {
-            return;
+            return TaskPumpStats();
+        }
+
+        return defaultEngine->processTasks(budgetMicros);
+    }
+
+    void notifyMemoryPressure(v8::MemoryPressureLevel level)
+    {
+        if (defaultEngine)
+        {
+            defaultEngine->notifyMemoryPressure(level);
         }
+    }
+
+    void notifyLowMemory()
+    {
+        if (defaultEngine)
+        {
+            defaultEngine->notifyLowMemory();
+        }
+    }
+
+    bool startCpuProfile(int samplingIntervalMicros)
+    {
+        return defaultEngine && defaultEngine->startCpuProfile(samplingIntervalMicros);
+    }
+
+    bool stopCpuProfile(const std::string &filePath, CpuProfileFormat format)
+    {
+        return defaultEngine && defaultEngine->stopCpuProfile(filePath, format);
+    }
+
+    HeapStats getHeapStats()
+    {
+        return defaultEngine ? defaultEngine->getHeapStats() : HeapStats();
+    }
 
-        isolate->PerformMicrotaskCheckpoint();
-        promiseRejectionHandler->checkUnhandledRejections();
-        int taskCount = 0;
-        while (taskCount < MaxTasksPerFrame && v8::platform::PumpMessageLoop(mPlatform.get(), isolate))
+    bool writeHeapSnapshot(const std::string &filePath)
+    {
+        return defaultEngine && defaultEngine->writeHeapSnapshot(filePath);
+    }
+
+    void dumpLatencyStats(std::ostream &stream)
+    {
+        if (defaultEngine)
         {
-            isolate->PerformMicrotaskCheckpoint();
-            promiseRejectionHandler->checkUnhandledRejections();
-            taskCount++;
+            defaultEngine->getLatencyRecorder().dump(stream);
         }
     }
 
     void disposeV8()
     {
-        if (!isInit)
+        if (!defaultEngine)
         {
             return;
         }
 
-        isInit = false;
+        delete defaultEngine;
+        defaultEngine = nullptr;
 
-        delete promiseRejectionHandler;
-
-        isolate->Dispose();
-        v8::V8::Dispose();
-        v8::V8::DisposePlatform();
+        Engine::disposePlatform();
     }
 }  // namespace core
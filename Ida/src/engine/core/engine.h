@@ -2,7 +2,25 @@
 
 #include <v8.h>
 
+#include <atomic>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../../common/Logger.h"
 #include "ClientObjects.h"
+#include "runtime/Clock.h"
+#include "runtime/CpuProfile.h"
+#include "runtime/FunctionHandle.h"
+#include "runtime/HeapStats.h"
+#include "runtime/HostBuffer.h"
+#include "runtime/LatencyRecorder.h"
+#include "runtime/PerformanceTimeline.h"
+#include "runtime/PooledAllocator.h"
+#include "runtime/TaskQueue.h"
+#include "runtime/TimerScheduler.h"
 
 namespace core
 {
@@ -12,17 +30,338 @@ namespace core
     using ArgumentsProviderCallback = std::function<std::vector<v8::Local<v8::Value>>(v8::Isolate *)>;
     using ResultCallback = std::function<void(v8::Isolate *, v8::MaybeLocal<v8::Value>)>;
 
-    void initV8(char *appLocation);
+    struct EventRecord
+    {
+        std::string_view eventName;
+        ArgumentsProviderCallback argumentsProvider = nullptr;
+    };
+
+    enum class NearHeapLimitAction
+    {
+        // Logs the heap statistics and lets the heap grow by a quarter of the initial limit
+        Log,
+        // Logs the heap statistics and terminates the running script. The heap gets the same headroom to unwind.
+        Terminate
+    };
+
+    struct InitOptions
+    {
+        /// @brief Startup snapshot produced by createStartupSnapshot. When set, mod contexts are deserialized from it
+        /// instead of being bootstrapped from scratch. Falls back to the regular bootstrap if the blob is unusable.
+        std::string snapshotBlobPath;
+
+        /// @brief Heap generation limits in megabytes. 0 keeps the V8 default.
+        size_t maxOldGenerationSizeMb = 0;
+        size_t maxYoungGenerationSizeMb = 0;
+
+        NearHeapLimitAction nearHeapLimitAction = NearHeapLimitAction::Terminate;
+
+        /// @brief Memory kept in the pools of the ArrayBuffer allocator for reuse, in megabytes
+        size_t arrayBufferPoolMb = 8;
+    };
+
+    // Default time budget of processTasks. Bigger budget makes timeouts more precise at the risk of delaying frames
+    constexpr int64_t DefaultTaskBudgetMicros = 2000;
+
+    struct TaskPumpStats
+    {
+        int tasksRun = 0;
+        // Tasks that were ready, but left for the next call because the budget ran out
+        int tasksDeferred = 0;
+        int64_t elapsedMicros = 0;
+    };
+
+    /// @brief Binary log call site ids of the console calls, by the script id and the line of the caller. The script
+    /// ids are only unique in their isolate, so each engine has its own.
+    struct JsCallSiteCache
+    {
+        // The ids are only valid in the binary log generation they were defined for
+        uint32_t generation = 0;
+        std::unordered_map<uint64_t, uint32_t> ids;
+    };
+
+    class CodeCache;
+    class ModSession;
+    class PromiseRejectionHandler;
+    class StartupSnapshot;
+
+    /// @brief Owns one isolate with its task queue, promise rejection tracker and code cache. Engines are independent,
+    /// so several of them can run mods in parallel, each one on its own thread. An engine must only be used from one
+    /// thread at a time.
+    class Engine
+    {
+    public:
+        /// @brief Initializes the V8 platform shared by all engines. Call once per process before creating engines.
+        static void initPlatform(char *appLocation);
+
+        /// @brief Disposes the V8 platform. All engines must be destroyed before.
+        static void disposePlatform();
+
+        static bool isPlatformInit();
+
+        explicit Engine(const InitOptions &options = InitOptions());
+        ~Engine();
+
+        Engine(const Engine &) = delete;
+        Engine &operator=(const Engine &) = delete;
+
+        /// @brief Returns the engine owning the isolate, or nullptr if the isolate was not created by an engine
+        static Engine *fromIsolate(v8::Isolate *isolate);
+
+        v8::Isolate *getIsolate() const
+        {
+            return mIsolate;
+        }
+
+        void setCodeCacheDir(const std::string &cacheDirPath);
+
+        /// @brief Directory of the profiles and heap snapshots written by the scripts, "diagnostics" in the working
+        /// directory by default. Empty path stops the scripts from writing them.
+        void setDiagnosticsDir(const std::string &dirPath)
+        {
+            mDiagnosticsDir = dirPath;
+        }
+
+        const std::string &getDiagnosticsDir() const
+        {
+            return mDiagnosticsDir;
+        }
+
+        /// @brief Full path of a file written by a script in the diagnostics directory, creating its parent
+        /// directories. Returns an empty string if the path is absolute or goes up with "..", so the scripts can't
+        /// write elsewhere.
+        std::string resolveDiagnosticsPath(const std::string &relativePath) const;
+
+        /// @brief Creates the mod context, binds the client objects and runs the global script in it. The session is
+        /// created inactive. Returns nullptr if the global script failed.
+        std::unique_ptr<ModSession> createSession(const std::string &scriptFullPath,
+                                                  BindObjectsCallback bindObjectsCallback);
+
+        /// @brief Sets the JS log level of this engine and binds the console of every live session again, see
+        /// Console::inscope_bindConsole. The other engines keep their level.
+        void setJsLogLevel(Logger::LogLevel level);
+
+        Logger::LogLevel getJsLogLevel() const
+        {
+            return mJsLogLevel;
+        }
+
+        /// @brief Session whose context is entered, receiving the events and function calls
+        ModSession *getActiveSession() const
+        {
+            return mActiveSession;
+        }
+
+        /// @brief Runs the callback in a temporary session, destroyed when the callback returns. The session active
+        /// before is active again afterwards.
+        bool runModScript(std::string &scriptFullPath, BindObjectsCallback bindObjectsCallback, RunCallback callback);
+
+        void runSyncEvent(const std::string &eventName, const ObjectProviderCallback objectProvider,
+                          const ArgumentsProviderCallback argumentsProvider = nullptr);
+
+        /// @brief Delivers the events to JS in one call of _handleEvents, as an array of [eventName, ...args]. Each
+        /// event is handled in its own try/catch on the JS side, so one failing handler doesn't drop the rest. While
+        /// the latencies are recorded, each event is timed under its name by the default _handleEvents.
+        void runSyncEvents(std::span<const EventRecord> events, const ObjectProviderCallback objectProvider);
+
+        void runFunction(const std::string &functionName, bool requireFunction = false,
+                         const ObjectProviderCallback objectProvider = nullptr,
+                         const ArgumentsProviderCallback args = nullptr,
+                         const ResultCallback resultCallback = nullptr);
+
+        v8::MaybeLocal<v8::Value> inscope_runFunction(const std::string &functionName, bool requireFunction = false,
+                                                      std::vector<v8::Local<v8::Value>> *args = nullptr,
+                                                      const ObjectProviderCallback objectProvider = nullptr);
+
+        /// @brief Resolves the function once, for hot calls from the host. See FunctionHandle.
+        FunctionHandle inscope_resolveFunction(const std::string &functionName,
+                                               const ObjectProviderCallback objectProvider = nullptr);
+
+        void runFunction(const FunctionHandle &function, const ArgumentsProviderCallback args = nullptr,
+                         const ResultCallback resultCallback = nullptr);
+
+        v8::MaybeLocal<v8::Value> inscope_runScript(v8::Local<v8::Context> context, const std::string &scriptPath,
+                                                    const std::string &script = "");
+
+        /// @brief Shares host memory with JS without copying. See HostBuffer.
+        HostBuffer inscope_createHostBuffer(void *data, size_t byteLength,
+                                           HostBufferReleaseCallback onReleased = nullptr);
+
+        /// @brief Runs the ready tasks until the time budget is spent. At least one ready task runs per call, so a
+        /// single task longer than the budget still delays the frame.
+        TaskPumpStats processTasks(int64_t budgetMicros = DefaultTaskBudgetMicros);
+
+        void setTaskPolicy(TaskPolicy policy)
+        {
+            mTaskPolicy = policy;
+        }
+
+        // The owner tags the task for cancelTasks. A ModSession cancels its tasks when destroyed, so they never run in
+        // its disposed context.
+        void postTask(v8::Task *task, const void *owner = nullptr);
+
+        void postDelayedTask(v8::Task *task, double delay, const void *owner = nullptr);
+
+        /// @brief Drops the pending tasks posted with the owner, without running them
+        void cancelTasks(const void *owner);
+
+        /// @brief Sets the clock of the timers, the tasks and performance.now, e.g. a VirtualClock. Set it before
+        /// running scripts, as the pending deadlines are not converted. The clock is owned by the host, nullptr
+        /// restores the real time.
+        void setClock(Clock *clock);
+
+        /// @brief Current time of the engine clock in seconds
+        double getTime() const;
+
+        /// @brief Time of performance.now() zero
+        double getTimeOrigin() const
+        {
+            return mTimeOrigin;
+        }
+
+        /// @brief Earliest deadline of the pending timers and tasks, or infinity if there are none. A virtual clock can
+        /// be fast-forwarded to it.
+        double getNextDeadline() const;
+
+        /// @brief Starts sampling the JS call stacks, e.g. when a mod drops frames. Returns false if a profile is
+        /// already being recorded.
+        bool startCpuProfile(int samplingIntervalMicros = CpuProfileRecorder::DefaultSamplingIntervalMicros);
+
+        /// @brief Stops the profile and writes it to the file. Returns false if no profile was started or the file
+        /// can't be written.
+        bool stopCpuProfile(const std::string &filePath, CpuProfileFormat format = CpuProfileFormat::CpuProfile);
+
+        bool isCpuProfiling() const;
+
+        /// @brief Durations of the events, the function calls and the timers run by the engine. See LatencyRecorder.
+        LatencyRecorder &getLatencyRecorder()
+        {
+            return mLatencyRecorder;
+        }
+
+        /// @brief Marks and measures of the scripts, the host can drain them for its own profiling
+        PerformanceTimeline &getPerformanceTimeline()
+        {
+            return mPerformanceTimeline;
+        }
+
+        JsCallSiteCache &getJsCallSites()
+        {
+            return mJsCallSites;
+        }
+
+        /// @brief Timers of the JS contexts, run by processTasks together with the tasks
+        TimerScheduler &getTimerScheduler()
+        {
+            return mTimerScheduler;
+        }
+
+        /// @brief Forwards the memory pressure level of the system to V8. Only level changes are forwarded, so it can
+        /// be called every frame. Can be called from any thread, as it only touches the atomic level, the isolate
+        /// through MemoryPressureNotification, which V8 allows from any thread, and the pools through their mutex.
+        void notifyMemoryPressure(v8::MemoryPressureLevel level);
+
+        /// @brief Runs a full garbage collection and empties the ArrayBuffer pools, releasing as much memory as
+        /// possible. Slow, meant for the low memory signals of the system. Must be called on the isolate thread.
+        void notifyLowMemory();
+
+        /// @brief Templates of the wrapped host classes, see Ida::ObjectWrap. Returns empty handle for unknown keys.
+        v8::Local<v8::FunctionTemplate> inscope_getClassTemplate(const void *classKey);
+        void inscope_setClassTemplate(const void *classKey, v8::Local<v8::FunctionTemplate> classTemplate);
+
+        ArrayBufferStats getArrayBufferStats();
+
+        /// @brief Sizes of the V8 heap and its spaces, cheap enough to sample every frame
+        HeapStats getHeapStats() const;
+
+        /// @brief Writes a .heapsnapshot of the isolate, to find what retains memory. Slow, see
+        /// core::writeHeapSnapshot.
+        bool writeHeapSnapshot(const std::string &filePath);
+
+        /// @brief Releases the pooled ArrayBuffer memory over the retained byte count, e.g. when leaving a level
+        void trimArrayBufferPool(size_t retainedBytes = 0);
+
+    private:
+        friend class ModSession;
+
+        v8::Isolate *mIsolate = nullptr;
+        ModSession *mActiveSession = nullptr;
+        // Live sessions, added and removed by the ModSession constructor and destructor
+        std::vector<ModSession *> mSessions;
+        Logger::LogLevel mJsLogLevel = Logger::getJsLogLevel();
+        NearHeapLimitAction mNearHeapLimitAction;
+        std::atomic<v8::MemoryPressureLevel> mMemoryPressureLevel = v8::MemoryPressureLevel::kNone;
+
+        static size_t onNearHeapLimit(void *data, size_t currentHeapLimit, size_t initialHeapLimit);
+
+        TaskQueue mTaskQueue;
+        TimerScheduler mTimerScheduler;
+        PerformanceTimeline mPerformanceTimeline;
+        LatencyRecorder mLatencyRecorder;
+        JsCallSiteCache mJsCallSites;
+        Clock *mClock = nullptr;
+        double mTimeOrigin = 0;
+        TaskPolicy mTaskPolicy = TaskPolicy::EarliestDeadlineFirst;
+
+        struct StringViewHash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view value) const
+            {
+                return std::hash<std::string_view>{}(value);
+            }
+        };
+
+        // Internalized event names, so the strings are not created again on every event
+        std::unordered_map<std::string, v8::Eternal<v8::String>, StringViewHash, std::equal_to<>> mEventNames;
+
+        v8::Local<v8::String> inscope_getEventName(std::string_view eventName);
+
+        // Records each event of a batch from the end times written by _handleEvents
+        void inscope_recordBatchLatencies(std::span<const EventRecord> events,
+                                          v8::Local<v8::ArrayBuffer> endTimesBuffer, int64_t startMicros, bool threw);
+
+        std::unordered_map<const void *, v8::Eternal<v8::FunctionTemplate>> mClassTemplates;
+        std::unique_ptr<PooledAllocator> mArrayBufferAllocator;
+        std::unique_ptr<StartupSnapshot> mStartupSnapshot;
+        std::unique_ptr<PromiseRejectionHandler> mPromiseRejectionHandler;
+        std::unique_ptr<CodeCache> mCodeCache;
+        std::unique_ptr<CpuProfileRecorder> mCpuProfileRecorder;
+        std::string mDiagnosticsDir;
+    };
+
+    // The functions below work with the default engine, created by initV8. The inscope_ ones use the engine of the
+    // current isolate, so they are also safe to call from the code running in the other engines.
+
+    void initV8(char *appLocation, const InitOptions &options = InitOptions());
+
+    Engine *getDefaultEngine();
+
+    /// @brief Writes a startup snapshot with the library bindings and global.js already set up. The blob must be
+    /// recreated when global.js or the V8 version changes. Requires initV8 to be called first.
+    bool createStartupSnapshot(const std::string &blobPath);
 
     bool isV8Init();
 
     v8::Isolate *getIsolate();
 
+    /// @brief Enables the persistent code cache for all scripts and modules, stored in the given directory. Empty path
+    /// disables it.
+    void setCodeCacheDir(const std::string &cacheDirPath);
+
+    /// @brief See Engine::setDiagnosticsDir
+    void setDiagnosticsDir(const std::string &dirPath);
+
+    /// @brief Sets the JS log level of the default engine and of the engines created after, see Engine::setJsLogLevel
+    void setJsLogLevel(Logger::LogLevel level);
+
     bool runModScript(std::string &scriptFullPath, BindObjectsCallback bindObjectsCallback, RunCallback callback);
 
     void runSyncEvent(const std::string &eventName, const ObjectProviderCallback objectProvider,
                       const ArgumentsProviderCallback argumentsProvider = nullptr);
 
+    void runSyncEvents(std::span<const EventRecord> events, const ObjectProviderCallback objectProvider);
+
     void runFunction(const std::string &functionName, bool requireFunction = false,
                      const ObjectProviderCallback objectProvider = nullptr,
                      const ArgumentsProviderCallback args = nullptr, const ResultCallback resultCallback = nullptr);
@@ -31,18 +370,46 @@ namespace core
                                                   std::vector<v8::Local<v8::Value>> *args = nullptr,
                                                   const ObjectProviderCallback objectProvider = nullptr);
 
+    FunctionHandle inscope_resolveFunction(const std::string &functionName,
+                                           const ObjectProviderCallback objectProvider = nullptr);
+
+    void runFunction(const FunctionHandle &function, const ArgumentsProviderCallback args = nullptr,
+                     const ResultCallback resultCallback = nullptr);
+
     /// @brief Runs a script unwrapped
     v8::MaybeLocal<v8::Value> inscope_runScript(v8::Local<v8::Context> context, const std::string &scriptPath,
                                                 const std::string &script = "");
+
+    HostBuffer inscope_createHostBuffer(void *data, size_t byteLength, HostBufferReleaseCallback onReleased = nullptr);
+
     v8::MaybeLocal<v8::Value> inscope_tryCatch(const std::function<v8::MaybeLocal<v8::Value>()> &callback);
 
+    /// @brief Logs an exception caught in JS as inscope_tryCatch logs an uncaught one, whatever the JS log level
+    void inscope_reportException(v8::Local<v8::Value> exception);
+
     v8::Local<v8::Object> inscope_GetObject(v8::Local<v8::Context> context, const char *objectName);
 
-    void processTasks();
+    TaskPumpStats processTasks(int64_t budgetMicros = DefaultTaskBudgetMicros);
 
+    // The tasks belong to the active session, if any, and are dropped with it
     void postTask(v8::Task *task);
 
     void postDelayedTask(v8::Task *task, double delay);
 
+    void notifyMemoryPressure(v8::MemoryPressureLevel level);
+
+    void notifyLowMemory();
+
+    bool startCpuProfile(int samplingIntervalMicros = CpuProfileRecorder::DefaultSamplingIntervalMicros);
+
+    bool stopCpuProfile(const std::string &filePath, CpuProfileFormat format = CpuProfileFormat::CpuProfile);
+
+    HeapStats getHeapStats();
+
+    /// @brief Writes the latency histograms of the default engine, the costliest entries first
+    void dumpLatencyStats(std::ostream &stream);
+
+    bool writeHeapSnapshot(const std::string &filePath);
+
     void disposeV8();
 }  // namespace core
@@ -45,6 +45,62 @@ namespace files
         file << content;
     }
 
+    std::vector<uint8_t> readAllBytes(const std::string &filePath)
+    {
+        std::string fullPath = toAbsolute(filePath);
+        std::ifstream file(fullPath, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open file: " + fullPath);
+        }
+
+        std::streamoff size = file.tellg();
+        if (size < 0)
+        {
+            throw std::runtime_error("Failed to get the size of file: " + fullPath);
+        }
+
+        std::vector<uint8_t> bytes(static_cast<size_t>(size));
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (file.gcount() != size)
+        {
+            throw std::runtime_error("Failed to read file: " + fullPath);
+        }
+        return bytes;
+    }
+
+    void writeAllBytes(const std::string &filePath, const uint8_t *data, size_t size)
+    {
+        // Written next to the file and renamed over it, so a crash while writing never leaves a truncated file
+        std::string fullPath = toAbsolute(filePath);
+        std::string temporaryPath = fullPath + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("Failed to open file for writing: " + temporaryPath);
+            }
+
+            file.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+            file.close();
+            if (!file)
+            {
+                std::error_code errorCode;
+                fs::remove(temporaryPath, errorCode);
+                throw std::runtime_error("Failed to write file: " + temporaryPath);
+            }
+        }
+
+        std::error_code errorCode;
+        fs::rename(temporaryPath, fullPath, errorCode);
+        if (errorCode)
+        {
+            fs::remove(temporaryPath, errorCode);
+            throw std::runtime_error("Failed to replace file: " + fullPath);
+        }
+    }
+
     bool copy(const std::string &sourcePath, const std::string &destinationPath)
     {
         std::string fullSourcePath = toAbsolute(sourcePath);
@@ -144,4 +200,23 @@ namespace files
         }
     }
 
+    int64_t getModifiedTime(const std::string &absolutePath)
+    {
+        std::error_code errorCode;
+        auto modifiedTime = fs::last_write_time(absolutePath, errorCode);
+        return errorCode ? -1 : static_cast<int64_t>(modifiedTime.time_since_epoch().count());
+    }
+
+    void createDirectories(const std::string &absolutePath)
+    {
+        try
+        {
+            fs::create_directories(absolutePath);
+        }
+        catch (const std::filesystem::filesystem_error &e)
+        {
+            Logger::err() << "Error creating directory: " << e.what();
+        }
+    }
+
 }  // namespace files
@@ -1,5 +1,7 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace files
 {
@@ -11,6 +13,11 @@ namespace files
 
     void writeAllText(const std::string &filepath, const std::string &content);
 
+    std::vector<uint8_t> readAllBytes(const std::string &filepath);
+
+    /// @brief Replaces the file at once, by writing a temporary file renamed over it
+    void writeAllBytes(const std::string &filepath, const uint8_t *data, size_t size);
+
     bool isAbsolute(const std::string &path);
 
     // Unix full path of this application directory
@@ -31,4 +38,10 @@ namespace files
     bool exists(const std::string &absolutePath);
 
     void deleteFile(const std::string &absolutePath);
+
+    /// @brief Last write time of the file in the filesystem clock ticks, or -1 if it can't be read
+    int64_t getModifiedTime(const std::string &absolutePath);
+
+    /// @brief Creates the directory with all its missing parents. Does nothing if it already exists.
+    void createDirectories(const std::string &absolutePath);
 }  // namespace files
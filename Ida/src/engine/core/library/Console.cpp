@@ -1,11 +1,77 @@
 #include "Console.h"
 
+#include <algorithm>
+#include <string>
+
 #include "../../../common/Logger.h"
+#include "../argumentsHandler.h"
+#include "../engine.h"
 
 namespace core
 {
+    // UTF-8 of the string arguments, reused by the thread so the logging doesn't allocate
+    static thread_local std::string argumentBuffer;
+
+    static void inscope_writeArgument(v8::Isolate *isolate, v8::Local<v8::Value> value, Logger::LogLine &stream)
+    {
+        // The binary log keeps the numbers and the booleans as they are, to be formatted by the decoder
+        if (stream.isBinary())
+        {
+            if (value->IsInt32())
+            {
+                stream << value.As<v8::Int32>()->Value();
+                return;
+            }
+            if (value->IsNumber())
+            {
+                stream << value.As<v8::Number>()->Value();
+                return;
+            }
+            if (value->IsBoolean())
+            {
+                stream << value->IsTrue();
+                return;
+            }
+        }
+
+        if (!value->IsString())
+        {
+            v8::String::Utf8Value str(isolate, value);
+            stream << *str;
+            return;
+        }
+
+        v8::Local<v8::String> string = value.As<v8::String>();
+
+        // One-byte strings are Latin-1, which is the same as UTF-8 when it's all ASCII
+        if (string->IsOneByte())
+        {
+            int length = string->Length();
+            argumentBuffer.resize(length);
+            string->WriteOneByte(isolate, reinterpret_cast<uint8_t *>(argumentBuffer.data()), 0, length,
+                                 v8::String::NO_NULL_TERMINATION);
+            if (std::all_of(argumentBuffer.begin(), argumentBuffer.end(),
+                            [](char c) { return static_cast<unsigned char>(c) < 0x80; }))
+            {
+                stream << std::string_view(argumentBuffer);
+                return;
+            }
+        }
+
+        int length = string->Utf8Length(isolate);
+        argumentBuffer.resize(length);
+        string->WriteUtf8(isolate, argumentBuffer.data(), length, nullptr,
+                          v8::String::NO_NULL_TERMINATION | v8::String::REPLACE_INVALID_UTF8);
+        stream << std::string_view(argumentBuffer);
+    }
+
     void Console::logToStream(const v8::FunctionCallbackInfo<v8::Value> &args, Logger::LogLine &&stream)
     {
+        if (stream.isVoid())
+        {
+            return;
+        }
+
         if (args.Length() < 1)
         {
             stream << "";
@@ -17,34 +83,192 @@ namespace core
 
         for (int i = 0; i < args.Length(); ++i)
         {
-            if (i > 0)
+            // The decoder puts the spaces between the arguments of the binary log
+            if (i > 0 && !stream.isBinary())
             {
                 stream << " ";
             }
 
-            v8::String::Utf8Value str(isolate, args[i]);
-            stream << *str;
+            inscope_writeArgument(isolate, args[i], stream);
         }
     }
 
+    // The sites of the scripts reloaded in the same binary log are not removed, so the cache is dropped past this size
+    constexpr size_t MaxCachedCallSites = 4096;
+
+    // Call site of the JS caller in the binary log, or 0 for the text log. The names of a site are only read the first
+    // time it logs in the binary log generation, see JsCallSiteCache.
+    static uint32_t inscope_getCallSiteId(v8::Isolate *isolate)
+    {
+        if (!Logger::isBinaryLog())
+        {
+            return 0;
+        }
+
+        v8::HandleScope handleScope(isolate);
+        v8::Local<v8::StackTrace> stackTrace = v8::StackTrace::CurrentStackTrace(isolate, 1);
+        if (stackTrace->GetFrameCount() < 1)
+        {
+            return 0;
+        }
+
+        v8::Local<v8::StackFrame> frame = stackTrace->GetFrame(isolate, 0);
+        int line = frame->GetLineNumber();
+        uint32_t generation = Logger::getBinaryLogGeneration();
+        auto getNamedId = [&]() {
+            v8::String::Utf8Value scriptName(isolate, frame->GetScriptName());
+            v8::String::Utf8Value functionName(isolate, frame->GetFunctionName());
+            return Logger::getCallSiteId(*scriptName ? *scriptName : "", static_cast<uint32_t>(line),
+                                         *functionName ? *functionName : "", generation);
+        };
+
+        // No engine while the startup snapshot is created
+        Engine *engine = Engine::fromIsolate(isolate);
+        if (!engine)
+        {
+            return getNamedId();
+        }
+
+        JsCallSiteCache &cache = engine->getJsCallSites();
+        if (cache.generation != generation || cache.ids.size() >= MaxCachedCallSites)
+        {
+            cache.ids.clear();
+            cache.generation = generation;
+        }
+
+        uint64_t key = static_cast<uint64_t>(static_cast<uint32_t>(frame->GetScriptId())) << 32 |
+                       static_cast<uint32_t>(line);
+        uint32_t &id = cache.ids[key];
+        if (id == 0)
+        {
+            id = getNamedId();
+        }
+        return id;
+    }
+
+    // Level of the engine, or the default one while the startup snapshot is created
+    static Logger::LogLevel getJsLogLevel(v8::Isolate *isolate)
+    {
+        Engine *engine = Engine::fromIsolate(isolate);
+        return engine ? engine->getJsLogLevel() : Logger::getJsLogLevel();
+    }
+
+    // The console methods of the disabled levels are no-ops, but the logger ones are always bound
     void Console::debug(const v8::FunctionCallbackInfo<v8::Value> &args)
     {
-        logToStream(args, Logger::jsDbg());
+        if (getJsLogLevel(args.GetIsolate()) <= Logger::LogLevel::DEBUG)
+        {
+            logToStream(args, Logger::jsDbg(inscope_getCallSiteId(args.GetIsolate())));
+        }
     }
 
     void Console::log(const v8::FunctionCallbackInfo<v8::Value> &args)
     {
-        logToStream(args, Logger::jsInf());
+        if (getJsLogLevel(args.GetIsolate()) <= Logger::LogLevel::INFO)
+        {
+            logToStream(args, Logger::jsInf(inscope_getCallSiteId(args.GetIsolate())));
+        }
     }
 
     void Console::warn(const v8::FunctionCallbackInfo<v8::Value> &args)
     {
-        logToStream(args, Logger::jsWrn());
+        if (getJsLogLevel(args.GetIsolate()) <= Logger::LogLevel::WARNING)
+        {
+            logToStream(args, Logger::jsWrn(inscope_getCallSiteId(args.GetIsolate())));
+        }
     }
 
     void Console::error(const v8::FunctionCallbackInfo<v8::Value> &args)
     {
-        logToStream(args, Logger::jsErr());
+        if (getJsLogLevel(args.GetIsolate()) <= Logger::LogLevel::ERROR)
+        {
+            logToStream(args, Logger::jsErr(inscope_getCallSiteId(args.GetIsolate())));
+        }
+    }
+
+    void Console::noop(const v8::FunctionCallbackInfo<v8::Value> &)
+    {
+    }
+
+    void Console::getLevel(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        args.GetReturnValue().Set(static_cast<int32_t>(getJsLogLevel(args.GetIsolate())));
+    }
+
+    void Console::setLevel(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        v8::Isolate *isolate = args.GetIsolate();
+        VALIDATE_ARGS_COUNT(1);
+        VALIDATE_INT_VALUE(args[0], level, static_cast<int32_t>(Logger::LogLevel::DEBUG),
+                           static_cast<int32_t>(Logger::LogLevel::NONE));
+
+        // Every session has its own console, bound to the level when it was created
+        Engine *engine = Engine::fromIsolate(isolate);
+        if (!engine)
+        {
+            Logger::setJsLogLevel(static_cast<Logger::LogLevel>(level));
+            inscope_bindConsole(isolate->GetCurrentContext());
+            return;
+        }
+        engine->setJsLogLevel(static_cast<Logger::LogLevel>(level));
+    }
+
+    void Console::reportException(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        v8::Isolate *isolate = args.GetIsolate();
+        VALIDATE_ARGS_COUNT(1);
+        inscope_reportException(args[0]);
+    }
+
+    void Console::inscope_bindConsole(v8::Local<v8::Context> context)
+    {
+        v8::Isolate *isolate = context->GetIsolate();
+        v8::HandleScope handleScope(isolate);
+
+        v8::Local<v8::Value> logger;
+        v8::Local<v8::Value> console;
+        if (!context->Global()->Get(context, v8::String::NewFromUtf8Literal(isolate, "logger")).ToLocal(&logger) ||
+            !context->Global()->Get(context, v8::String::NewFromUtf8Literal(isolate, "console")).ToLocal(&console) ||
+            !logger->IsObject() || !console->IsObject())
+        {
+            return;
+        }
+
+        struct ConsoleMethod
+        {
+            const char *name;
+            Logger::LogLevel level;
+        };
+        static constexpr ConsoleMethod methods[] = {{"debug", Logger::LogLevel::DEBUG},
+                                                    {"log", Logger::LogLevel::INFO},
+                                                    {"info", Logger::LogLevel::INFO},
+                                                    {"warn", Logger::LogLevel::WARNING},
+                                                    {"error", Logger::LogLevel::ERROR}};
+
+        Logger::LogLevel level = getJsLogLevel(isolate);
+        v8::Local<v8::Function> noopFunction = v8::Function::New(context, noop).ToLocalChecked();
+        for (const ConsoleMethod &method : methods)
+        {
+            v8::Local<v8::String> name = v8::String::NewFromUtf8(isolate, method.name).ToLocalChecked();
+            v8::Local<v8::Value> function = noopFunction;
+            if (level <= method.level)
+            {
+                function = logger.As<v8::Object>()->Get(context, name).ToLocalChecked();
+            }
+            console.As<v8::Object>()->Set(context, name, function).Check();
+        }
+    }
+
+    void Console::addExternalReferences(std::vector<intptr_t> &references)
+    {
+        references.push_back(reinterpret_cast<intptr_t>(debug));
+        references.push_back(reinterpret_cast<intptr_t>(log));
+        references.push_back(reinterpret_cast<intptr_t>(warn));
+        references.push_back(reinterpret_cast<intptr_t>(error));
+        references.push_back(reinterpret_cast<intptr_t>(noop));
+        references.push_back(reinterpret_cast<intptr_t>(getLevel));
+        references.push_back(reinterpret_cast<intptr_t>(setLevel));
+        references.push_back(reinterpret_cast<intptr_t>(reportException));
     }
 
     // Bind the console object to the global object
@@ -58,9 +282,14 @@ namespace core
         console->Set(v8::String::NewFromUtf8Literal(isolate, "log"), v8::FunctionTemplate::New(isolate, log));
         console->Set(v8::String::NewFromUtf8Literal(isolate, "warn"), v8::FunctionTemplate::New(isolate, warn));
         console->Set(v8::String::NewFromUtf8Literal(isolate, "error"), v8::FunctionTemplate::New(isolate, error));
+        console->SetAccessorProperty(v8::String::NewFromUtf8Literal(isolate, "level"),
+                                     v8::FunctionTemplate::New(isolate, getLevel),
+                                     v8::FunctionTemplate::New(isolate, setLevel));
 
         // Add the console object to the global logger template (because V8 already has defined console that is not easy
         // to override from here)
         global->Set(v8::String::NewFromUtf8Literal(isolate, "logger"), console);
+        global->Set(v8::String::NewFromUtf8Literal(isolate, "_reportException"),
+                    v8::FunctionTemplate::New(isolate, reportException));
     }
 }  // namespace core
@@ -2,6 +2,8 @@
 
 #include <v8.h>
 #include <iostream>
+#include <vector>
+
 #include "../../../common/Logger.h"
 
 namespace core
@@ -14,7 +16,14 @@ namespace core
     public:
         Console() = default;
 
-        void inscope_bind(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> global);
+        static void inscope_bind(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> global);
+
+        static void addExternalReferences(std::vector<intptr_t> &references);
+
+        /// @brief Assigns the logger methods of the enabled JS log levels to the console of the context, and a no-op to
+        /// the disabled ones, so the disabled calls don't even reach C++. Done again in every session when logger.level
+        /// is set, see Engine::setJsLogLevel. The level is the one of the engine of the isolate.
+        static void inscope_bindConsole(v8::Local<v8::Context> context);
 
     private:
         // Static methods for console.log and console.error
@@ -22,6 +31,14 @@ namespace core
         static void log(const v8::FunctionCallbackInfo<v8::Value> &args);
         static void warn(const v8::FunctionCallbackInfo<v8::Value> &args);
         static void error(const v8::FunctionCallbackInfo<v8::Value> &args);
+        static void noop(const v8::FunctionCallbackInfo<v8::Value> &args);
+
+        // Accessor of logger.level, the JS log level from 0 (debug) to 4 (none)
+        static void getLevel(const v8::FunctionCallbackInfo<v8::Value> &args);
+        static void setLevel(const v8::FunctionCallbackInfo<v8::Value> &args);
+
+        // _reportException(error), for the exceptions caught by global.js
+        static void reportException(const v8::FunctionCallbackInfo<v8::Value> &args);
 
         // Helper method to log to a stream
         static void logToStream(const v8::FunctionCallbackInfo<v8::Value> &args, Logger::LogLine &&stream);
@@ -1,5 +1,10 @@
 #include "Performance.h"
 
+#include <string>
+
+#include "../argumentsHandler.h"
+#include "../engine.h"
+
 namespace core
 {
 
@@ -8,15 +13,142 @@ namespace core
         v8::Local<v8::ObjectTemplate> performance = v8::ObjectTemplate::New(isolate);
         performance->Set(v8::String::NewFromUtf8(isolate, "now", v8::NewStringType::kNormal).ToLocalChecked(),
                          v8::FunctionTemplate::New(isolate, now));
+        performance->Set(v8::String::NewFromUtf8Literal(isolate, "mark"), v8::FunctionTemplate::New(isolate, mark));
+        performance->Set(v8::String::NewFromUtf8Literal(isolate, "measure"),
+                         v8::FunctionTemplate::New(isolate, measure));
+        performance->Set(v8::String::NewFromUtf8Literal(isolate, "getEntries"),
+                         v8::FunctionTemplate::New(isolate, getEntries));
         global->Set(v8::String::NewFromUtf8(isolate, "performance", v8::NewStringType::kNormal).ToLocalChecked(),
                     performance);
+        global->Set(v8::String::NewFromUtf8Literal(isolate, "_latencyNow"),
+                    v8::FunctionTemplate::New(isolate, latencyNow));
+    }
+
+    void Performance::addExternalReferences(std::vector<intptr_t> &references)
+    {
+        references.push_back(reinterpret_cast<intptr_t>(now));
+        references.push_back(reinterpret_cast<intptr_t>(mark));
+        references.push_back(reinterpret_cast<intptr_t>(measure));
+        references.push_back(reinterpret_cast<intptr_t>(getEntries));
+        references.push_back(reinterpret_cast<intptr_t>(latencyNow));
+    }
+
+    using NameBuffer = char[PerformanceEntry::MaxNameLength + 1];
+
+    // Milliseconds since the time origin of the engine, read from the engine clock
+    static double getNow(Engine *engine)
+    {
+        return (engine->getTime() - engine->getTimeOrigin()) * 1000.0;
+    }
+
+    // Reads the entry name without allocating, truncated to the length kept by the timeline
+    static std::string_view inscope_readName(v8::Isolate *isolate, v8::Local<v8::Value> value, NameBuffer &buffer)
+    {
+        int length = value.As<v8::String>()->WriteUtf8(isolate, buffer, PerformanceEntry::MaxNameLength, nullptr,
+                                                        v8::String::NO_NULL_TERMINATION |
+                                                            v8::String::REPLACE_INVALID_UTF8);
+        return std::string_view(buffer, length);
     }
 
     void Performance::now(const v8::FunctionCallbackInfo<v8::Value> &args)
     {
-        v8::HandleScope handleScope(args.GetIsolate());
+        args.GetReturnValue().Set(getNow(Engine::fromIsolate(args.GetIsolate())));
+    }
+
+    void Performance::mark(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        v8::Isolate *isolate = args.GetIsolate();
 
-        // TODO - hook source of ticks here - SDL or other
-        // args.GetReturnValue().Set(v8::Number::New(args.GetIsolate(), SDL_GetTicks64()));
+        if (args.Length() < 1 || !args[0]->IsString())
+        {
+            inscope_ThrowTypeError(isolate, "Invalid arguments. Usage: performance.mark(name).");
+            return;
+        }
+
+        Engine *engine = Engine::fromIsolate(isolate);
+        NameBuffer name;
+        engine->getPerformanceTimeline().add(PerformanceEntryType::Mark, inscope_readName(isolate, args[0], name),
+                                             getNow(engine), 0);
+    }
+
+    // Returns the measured duration. Without the marks, measures from the time origin to now.
+    void Performance::measure(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        v8::Isolate *isolate = args.GetIsolate();
+
+        auto isOptionalString = [&args](int index) {
+            return args.Length() <= index || args[index]->IsString() || args[index]->IsUndefined();
+        };
+        if (args.Length() < 1 || !args[0]->IsString() || !isOptionalString(1) || !isOptionalString(2))
+        {
+            inscope_ThrowTypeError(isolate,
+                                   "Invalid arguments. Usage: performance.measure(name[, startMark[, endMark]]).");
+            return;
+        }
+
+        Engine *engine = Engine::fromIsolate(isolate);
+        PerformanceTimeline &timeline = engine->getPerformanceTimeline();
+
+        double times[] = {0, getNow(engine)};
+        for (int i = 0; i < 2; i++)
+        {
+            if (args.Length() <= i + 1 || !args[i + 1]->IsString())
+            {
+                continue;
+            }
+
+            NameBuffer buffer;
+            std::string_view markName = inscope_readName(isolate, args[i + 1], buffer);
+            if (!timeline.findMark(markName, times[i]))
+            {
+                inscope_ThrowError(isolate, "The mark '" + std::string(markName) + "' does not exist");
+                return;
+            }
+        }
+
+        NameBuffer name;
+        double duration = times[1] - times[0];
+        timeline.add(PerformanceEntryType::Measure, inscope_readName(isolate, args[0], name), times[0], duration);
+        args.GetReturnValue().Set(duration);
+    }
+
+    void Performance::getEntries(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        v8::Isolate *isolate = args.GetIsolate();
+        v8::EscapableHandleScope handleScope(isolate);
+        v8::Local<v8::Context> context = isolate->GetCurrentContext();
+
+        v8::Local<v8::Name> keys[] = {
+            v8::String::NewFromUtf8Literal(isolate, "name", v8::NewStringType::kInternalized),
+            v8::String::NewFromUtf8Literal(isolate, "entryType", v8::NewStringType::kInternalized),
+            v8::String::NewFromUtf8Literal(isolate, "startTime", v8::NewStringType::kInternalized),
+            v8::String::NewFromUtf8Literal(isolate, "duration", v8::NewStringType::kInternalized)};
+        v8::Local<v8::Value> entryTypes[] = {
+            v8::String::NewFromUtf8Literal(isolate, "mark", v8::NewStringType::kInternalized),
+            v8::String::NewFromUtf8Literal(isolate, "measure", v8::NewStringType::kInternalized)};
+
+        PerformanceTimeline &timeline = Engine::fromIsolate(isolate)->getPerformanceTimeline();
+        v8::Local<v8::Array> entries = v8::Array::New(isolate, static_cast<int>(timeline.size()));
+        uint32_t index = 0;
+        timeline.forEach([&](const PerformanceEntry &entry) {
+            v8::Local<v8::Value> values[] = {
+                v8::String::NewFromUtf8(isolate, entry.name).ToLocalChecked(),
+                entryTypes[static_cast<int>(entry.type)], v8::Number::New(isolate, entry.startTime),
+                v8::Number::New(isolate, entry.duration)};
+            v8::Local<v8::Object> object = v8::Object::New(isolate);
+            for (size_t i = 0; i < std::size(keys); i++)
+            {
+                object->CreateDataProperty(context, keys[i], values[i]).Check();
+            }
+            entries->Set(context, index++, object).Check();
+        });
+
+        args.GetReturnValue().Set(handleScope.Escape(entries));
+    }
+
+    // Clock of the LatencyRecorder in microseconds, read by _handleEvents to time each event of a batch
+    void Performance::latencyNow(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        args.GetReturnValue().Set(static_cast<double>(LatencyRecorder::now()));
     }
 }  // namespace core
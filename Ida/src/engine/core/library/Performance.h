@@ -2,14 +2,22 @@
 
 #include <v8.h>
 
+#include <vector>
+
 namespace core
 {
     class Performance
     {
     public:
-        void inscope_bind(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> global);
+        static void inscope_bind(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> global);
+
+        static void addExternalReferences(std::vector<intptr_t> &references);
 
     private:
         static void now(const v8::FunctionCallbackInfo<v8::Value> &args);
+        static void mark(const v8::FunctionCallbackInfo<v8::Value> &args);
+        static void measure(const v8::FunctionCallbackInfo<v8::Value> &args);
+        static void getEntries(const v8::FunctionCallbackInfo<v8::Value> &args);
+        static void latencyNow(const v8::FunctionCallbackInfo<v8::Value> &args);
     };
 }  // namespace core
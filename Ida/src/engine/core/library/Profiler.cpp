@@ -0,0 +1,164 @@
+#include "Profiler.h"
+
+#include <string>
+
+#include "../argumentsHandler.h"
+#include "../engine.h"
+
+namespace core
+{
+    void Profiler::inscope_bind(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> global)
+    {
+        v8::Local<v8::ObjectTemplate> profiler = v8::ObjectTemplate::New(isolate);
+        profiler->Set(v8::String::NewFromUtf8Literal(isolate, "start"), v8::FunctionTemplate::New(isolate, start));
+        profiler->Set(v8::String::NewFromUtf8Literal(isolate, "stop"), v8::FunctionTemplate::New(isolate, stop));
+        profiler->Set(v8::String::NewFromUtf8Literal(isolate, "getHeapStats"),
+                      v8::FunctionTemplate::New(isolate, getHeapStats));
+        profiler->Set(v8::String::NewFromUtf8Literal(isolate, "writeHeapSnapshot"),
+                      v8::FunctionTemplate::New(isolate, writeHeapSnapshot));
+        global->Set(v8::String::NewFromUtf8Literal(isolate, "profiler"), profiler);
+    }
+
+    void Profiler::addExternalReferences(std::vector<intptr_t> &references)
+    {
+        references.push_back(reinterpret_cast<intptr_t>(start));
+        references.push_back(reinterpret_cast<intptr_t>(stop));
+        references.push_back(reinterpret_cast<intptr_t>(getHeapStats));
+        references.push_back(reinterpret_cast<intptr_t>(writeHeapSnapshot));
+    }
+
+    // The scripts only write in the diagnostics directory of the host
+    static bool inscope_resolveOutputPath(v8::Isolate *isolate, const std::string &filePath, std::string &fullPath)
+    {
+        Engine *engine = Engine::fromIsolate(isolate);
+        if (engine->getDiagnosticsDir().empty())
+        {
+            inscope_ThrowError(isolate, "Writing diagnostics files is disabled");
+            return false;
+        }
+
+        fullPath = engine->resolveDiagnosticsPath(filePath);
+        if (fullPath.empty())
+        {
+            inscope_ThrowRangeError(isolate, "filePath must be relative to the diagnostics directory, without \"..\"");
+            return false;
+        }
+        return true;
+    }
+
+    // profiler.start([samplingIntervalMicros]) returns false if a profile is already being recorded
+    void Profiler::start(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        v8::Isolate *isolate = args.GetIsolate();
+
+        int samplingIntervalMicros = CpuProfileRecorder::DefaultSamplingIntervalMicros;
+        if (args.Length() > 0 && !args[0]->IsUndefined())
+        {
+            VALIDATE_INT_VALUE(args[0], samplingInterval, 1);
+            samplingIntervalMicros = samplingInterval;
+        }
+
+        args.GetReturnValue().Set(Engine::fromIsolate(isolate)->startCpuProfile(samplingIntervalMicros));
+    }
+
+    // profiler.stop(filePath[, format]), the format being "cpuprofile" (default) or "collapsed". The path is relative
+    // to the diagnostics directory.
+    void Profiler::stop(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        v8::Isolate *isolate = args.GetIsolate();
+
+        VALIDATE_ARGS_COUNT(1);
+        VALIDATE_STRING(args[0], filePath, true);
+
+        CpuProfileFormat format = CpuProfileFormat::CpuProfile;
+        if (args.Length() > 1 && !args[1]->IsUndefined())
+        {
+            VALIDATE_STRING(args[1], formatName, true);
+            if (formatName == "collapsed")
+            {
+                format = CpuProfileFormat::CollapsedStacks;
+            }
+            else if (formatName != "cpuprofile")
+            {
+                inscope_ThrowRangeError(isolate, "format must be \"cpuprofile\" or \"collapsed\"");
+                return;
+            }
+        }
+
+        // Checked before stopping, so a wrong path doesn't lose the profile
+        std::string fullPath;
+        if (!inscope_resolveOutputPath(isolate, filePath, fullPath))
+        {
+            return;
+        }
+
+        args.GetReturnValue().Set(Engine::fromIsolate(isolate)->stopCpuProfile(fullPath, format));
+    }
+
+    static void inscope_setNumber(v8::Local<v8::Context> context, v8::Local<v8::Object> object, const char *key,
+                                  size_t value)
+    {
+        v8::Isolate *isolate = context->GetIsolate();
+        object
+            ->CreateDataProperty(context, v8::String::NewFromUtf8(isolate, key).ToLocalChecked(),
+                                 v8::Number::New(isolate, static_cast<double>(value)))
+            .Check();
+    }
+
+    // Sizes in bytes, with the spaces as an array of {name, size, usedSize, availableSize, physicalSize}
+    void Profiler::getHeapStats(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        v8::Isolate *isolate = args.GetIsolate();
+        v8::Local<v8::Context> context = isolate->GetCurrentContext();
+        HeapStats stats = Engine::fromIsolate(isolate)->getHeapStats();
+
+        v8::Local<v8::Object> result = v8::Object::New(isolate);
+        inscope_setNumber(context, result, "totalHeapSize", stats.totalHeapSize);
+        inscope_setNumber(context, result, "totalHeapSizeExecutable", stats.totalHeapSizeExecutable);
+        inscope_setNumber(context, result, "totalPhysicalSize", stats.totalPhysicalSize);
+        inscope_setNumber(context, result, "totalAvailableSize", stats.totalAvailableSize);
+        inscope_setNumber(context, result, "usedHeapSize", stats.usedHeapSize);
+        inscope_setNumber(context, result, "heapSizeLimit", stats.heapSizeLimit);
+        inscope_setNumber(context, result, "mallocedMemory", stats.mallocedMemory);
+        inscope_setNumber(context, result, "peakMallocedMemory", stats.peakMallocedMemory);
+        inscope_setNumber(context, result, "externalMemory", stats.externalMemory);
+        inscope_setNumber(context, result, "nativeContextCount", stats.nativeContextCount);
+        inscope_setNumber(context, result, "detachedContextCount", stats.detachedContextCount);
+
+        v8::Local<v8::Array> spaces = v8::Array::New(isolate, static_cast<int>(stats.spaceCount));
+        for (size_t i = 0; i < stats.spaceCount; i++)
+        {
+            const HeapSpaceStats &spaceStats = stats.spaces[i];
+            v8::Local<v8::Object> space = v8::Object::New(isolate);
+            space
+                ->CreateDataProperty(context, v8::String::NewFromUtf8Literal(isolate, "name"),
+                                     v8::String::NewFromUtf8(isolate, spaceStats.name).ToLocalChecked())
+                .Check();
+            inscope_setNumber(context, space, "size", spaceStats.size);
+            inscope_setNumber(context, space, "usedSize", spaceStats.usedSize);
+            inscope_setNumber(context, space, "availableSize", spaceStats.availableSize);
+            inscope_setNumber(context, space, "physicalSize", spaceStats.physicalSize);
+            spaces->Set(context, static_cast<uint32_t>(i), space).Check();
+        }
+        result->CreateDataProperty(context, v8::String::NewFromUtf8Literal(isolate, "spaces"), spaces).Check();
+
+        args.GetReturnValue().Set(result);
+    }
+
+    // profiler.writeHeapSnapshot(filePath), the path being relative to the diagnostics directory
+    void Profiler::writeHeapSnapshot(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        v8::Isolate *isolate = args.GetIsolate();
+
+        VALIDATE_ARGS_COUNT(1);
+        VALIDATE_STRING(args[0], filePath, true);
+
+        std::string fullPath;
+        if (!inscope_resolveOutputPath(isolate, filePath, fullPath))
+        {
+            return;
+        }
+
+        args.GetReturnValue().Set(Engine::fromIsolate(isolate)->writeHeapSnapshot(fullPath));
+    }
+}  // namespace core
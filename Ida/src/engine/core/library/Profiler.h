@@ -0,0 +1,24 @@
+#pragma once
+
+#include <v8.h>
+
+#include <vector>
+
+namespace core
+{
+    // The profiler object of JS, recording the CPU profile of the engine and reporting its memory. See
+    // CpuProfileRecorder and HeapStats.
+    class Profiler
+    {
+    public:
+        static void inscope_bind(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> global);
+
+        static void addExternalReferences(std::vector<intptr_t> &references);
+
+    private:
+        static void start(const v8::FunctionCallbackInfo<v8::Value> &args);
+        static void stop(const v8::FunctionCallbackInfo<v8::Value> &args);
+        static void getHeapStats(const v8::FunctionCallbackInfo<v8::Value> &args);
+        static void writeHeapSnapshot(const v8::FunctionCallbackInfo<v8::Value> &args);
+    };
+}  // namespace core
@@ -1,5 +1,9 @@
 #include "Require.h"
 
+#include <algorithm>
+
+#include "../../../common/Logger.h"
+#include "../EmbedderSlots.h"
 #include "../engine.h"
 #include "../files.h"
 
@@ -26,8 +30,18 @@ namespace core
             return;
         }
 
-        // Reading the function data
-        auto *data = static_cast<RequireData *>(args.Data().As<External>()->Value());
+        // Reading the function data. Nested require functions carry their data, the root one reads it from the context
+        auto *data = args.Data()->IsExternal()
+                         ? static_cast<RequireData *>(args.Data().As<External>()->Value())
+                         : static_cast<RequireData *>(isolate->GetCurrentContext()->GetAlignedPointerFromEmbedderData(
+                               static_cast<int>(ContextSlot::Require)));
+        if (!data)
+        {
+            isolate->ThrowException(Exception::Error(v8::String::NewFromUtf8Literal(
+                isolate, "require is not available while the startup snapshot is created, require the modules from "
+                         "the mod script instead")));
+            return;
+        }
         Require *thisObject = data->thisObject;
         std::string moduleRootPath = data->moduleRootPath;
 
@@ -55,18 +69,34 @@ namespace core
 
         Local<Context> context = isolate->GetCurrentContext();
 
-        // Check if the module is already cached
-        auto cached = thisObject->mModuleCache.find(modulePath);
-        if (cached != thisObject->mModuleCache.end())
-        {
-            Local<Object> module = cached->second.Get(isolate).As<Object>();
-            Local<Value> moduleExports =
-                module->Get(context, v8::String::NewFromUtf8Literal(isolate, "exports")).ToLocalChecked();
+        // Recording the dependency for the hot reload, also when the module is already cached
+        ModuleRecord &record = thisObject->mModules[modulePath];
+        record.dependents.insert(data->modulePath);
 
-            args.GetReturnValue().Set(moduleExports);
+        Local<Value> module;
+        if (!record.module.IsEmpty())
+        {
+            module = record.module.Get(isolate);
+        }
+        else if (!thisObject->inscope_loadModule(context, modulePath).ToLocal(&module))
+        {
             return;
         }
 
+        // Return module.exports
+        Local<Value> moduleExports =
+            module.As<Object>()->Get(context, v8::String::NewFromUtf8Literal(isolate, "exports")).ToLocalChecked();
+        args.GetReturnValue().Set(moduleExports);
+    }
+
+    // Evaluates the module and caches it. Throws the JS exception and returns empty result on failure.
+    MaybeLocal<Value> Require::inscope_loadModule(Local<Context> context, const std::string &modulePath)
+    {
+        Isolate *isolate = context->GetIsolate();
+        ModuleRecord &record = mModules[modulePath];
+
+        // The time is taken before reading, so a change made while loading is still detected by the next scan
+        int64_t modifiedTime = files::getModifiedTime(modulePath);
         std::string scriptContent;
         try
         {
@@ -75,9 +105,11 @@ namespace core
         catch (const std::exception &e)
         {
             isolate->ThrowException(Exception::Error(v8::String::NewFromUtf8(isolate, e.what()).ToLocalChecked()));
-            return;
+            return MaybeLocal<Value>();
         }
 
+        size_t contentHash = std::hash<std::string>{}(scriptContent);
+
         // Wrap module content into the module wrapper function
         std::string wrappedScript =
             "(function(exports, require, module, __filename, __dirname) { " + scriptContent + "\n})";
@@ -90,7 +122,7 @@ namespace core
             std::string errorMessage = "Failed to execute module " + modulePath;
             isolate->ThrowException(
                 Exception::Error(v8::String::NewFromUtf8(isolate, errorMessage.c_str()).ToLocalChecked()));
-            return;
+            return MaybeLocal<Value>();
         }
 
         Local<Function> moduleFunction = Local<Function>::Cast(result);
@@ -102,7 +134,7 @@ namespace core
 
         // Create require function for this module
         std::string dirPath = files::getDirPath(modulePath);
-        auto newRequireData = new RequireData{thisObject, dirPath};
+        auto newRequireData = new RequireData{this, dirPath, modulePath};
         Local<Function> requireFunction =
             Function::New(context, require, External::New(isolate, newRequireData)).ToLocalChecked();
 
@@ -122,24 +154,122 @@ namespace core
             std::string errorMessage = "Error loading the module: " + modulePath;
             isolate->ThrowException(
                 Exception::Error(v8::String::NewFromUtf8(isolate, errorMessage.c_str()).ToLocalChecked()));
-            return;
+            return MaybeLocal<Value>();
         }
 
-        // Getting module.exports again for the case the module overrides it
-        Local<Value> moduleExports =
-            module->Get(context, v8::String::NewFromUtf8Literal(isolate, "exports")).ToLocalChecked();
+        // Cache the module. The file version is only kept once it evaluated, so a failed reload is tried again.
+        record.modifiedTime = modifiedTime;
+        record.contentHash = contentHash;
+        record.module.Reset(isolate, module);
+        return module;
+    }
 
-        // Cache the module
-        thisObject->mModuleCache[modulePath].Reset(isolate, module);
+    std::vector<std::string> Require::inscope_reloadChangedModules(Local<Context> context)
+    {
+        Isolate *isolate = context->GetIsolate();
 
-        // Return module.exports
-        args.GetReturnValue().Set(moduleExports);
+        std::unordered_set<std::string> visited;
+        std::vector<std::string> postOrder;
+        for (auto &[modulePath, record] : mModules)
+        {
+            if (!record.module.IsEmpty() && isModuleChanged(modulePath, record))
+            {
+                collectDependents(modulePath, visited, postOrder);
+            }
+        }
+
+        // Every module comes after its dependencies, so a dependent requires the reloaded exports
+        std::reverse(postOrder.begin(), postOrder.end());
+
+        // All the stale modules are dropped before evaluating, otherwise a dependent could pick up an old dependency
+        std::unordered_map<std::string, Global<Value>> previousModules;
+        for (const std::string &modulePath : postOrder)
+        {
+            previousModules[modulePath] = std::move(mModules[modulePath].module);
+        }
+
+        std::vector<std::string> reloadedModules;
+        for (const std::string &modulePath : postOrder)
+        {
+            ModuleRecord &record = mModules[modulePath];
+            if (record.module.IsEmpty())
+            {
+                HandleScope handleScope(isolate);
+                if (inscope_tryCatch([&]() { return inscope_loadModule(context, modulePath); }).IsEmpty())
+                {
+                    Logger::err() << "Failed to reload module " << modulePath << ", keeping the previous version";
+                    record.module = std::move(previousModules[modulePath]);
+                    continue;
+                }
+            }
+
+            reloadedModules.push_back(modulePath);
+        }
+
+        return reloadedModules;
+    }
+
+    bool Require::isModuleChanged(const std::string &modulePath, ModuleRecord &record)
+    {
+        // A deleted file keeps its module
+        int64_t modifiedTime = files::getModifiedTime(modulePath);
+        if (modifiedTime < 0 || modifiedTime == record.modifiedTime)
+        {
+            return false;
+        }
+
+        // Touched files are not reloaded if the content is the same. The time of a changed file is kept by the
+        // successful reload, so a module failing to evaluate is tried again on the next scan.
+        try
+        {
+            if (std::hash<std::string>{}(files::readAllText(modulePath)) != record.contentHash)
+            {
+                return true;
+            }
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+
+        record.modifiedTime = modifiedTime;
+        return false;
+    }
+
+    void Require::collectDependents(const std::string &modulePath, std::unordered_set<std::string> &visited,
+                                    std::vector<std::string> &postOrder)
+    {
+        auto found = mModules.find(modulePath);
+        if (found == mModules.end() || !visited.insert(modulePath).second)
+        {
+            return;
+        }
+
+        for (const std::string &dependent : found->second.dependents)
+        {
+            collectDependents(dependent, visited, postOrder);
+        }
+        postOrder.push_back(modulePath);
     }
 
     void Require::inscope_bind(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> global)
     {
-        global->Set(v8::String::NewFromUtf8Literal(isolate, "require"),
-                    v8::FunctionTemplate::New(isolate, require, External::New(isolate, &mRootData)));
+        global->Set(v8::String::NewFromUtf8Literal(isolate, "require"), v8::FunctionTemplate::New(isolate, require));
+    }
+
+    void Require::addExternalReferences(std::vector<intptr_t> &references)
+    {
+        references.push_back(reinterpret_cast<intptr_t>(require));
+    }
+
+    void Require::inscope_attach(v8::Local<v8::Context> context)
+    {
+        context->SetAlignedPointerInEmbedderData(static_cast<int>(ContextSlot::Require), &mRootData);
+    }
+
+    void Require::inscope_detach(v8::Local<v8::Context> context)
+    {
+        context->SetAlignedPointerInEmbedderData(static_cast<int>(ContextSlot::Require), nullptr);
     }
 
     bool Require::allowedPathStart(const std::string &path)
@@ -1,7 +1,10 @@
 #pragma once
 #include <v8.h>
 
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "../files.h"
 
@@ -10,19 +13,52 @@ namespace core
     class Require
     {
     public:
-        void inscope_bind(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> global);
+        static void inscope_bind(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> global);
+
+        static void addExternalReferences(std::vector<intptr_t> &references);
+
+        // Makes this object the one resolving the root require calls in the context
+        void inscope_attach(v8::Local<v8::Context> context);
+
+        // Leaves the context without a Require object, so the root require calls throw. Used for the startup snapshot,
+        // whose module cache would not survive into the blob.
+        static void inscope_detach(v8::Local<v8::Context> context);
+
+        /// @brief Re-evaluates the modules whose files changed since they were loaded, and the modules depending on
+        /// them, keeping the rest of the module cache. Changes are found by the file modification time, confirmed by
+        /// the content hash. A module that fails to reload keeps its previous exports, and is tried again by the next
+        /// call. Returns the reloaded module paths. The scripts that required the modules from the global scope keep
+        /// the old exports.
+        std::vector<std::string> inscope_reloadChangedModules(v8::Local<v8::Context> context);
 
     private:
         struct RequireData
         {
-            Require *thisObject;
-            std::string moduleRootPath;
-            v8::Global<v8::Function> thisFunction;
+            Require *thisObject = nullptr;
+            std::string moduleRootPath = {};
+            // Module the require function belongs to, empty for the global one
+            std::string modulePath = {};
+            v8::Global<v8::Function> thisFunction = {};
+        };
+
+        struct ModuleRecord
+        {
+            // Empty while the module is being reloaded
+            v8::Global<v8::Value> module;
+            int64_t modifiedTime = -1;
+            size_t contentHash = 0;
+            // Modules that required this one. Empty path stands for the global scope.
+            std::unordered_set<std::string> dependents;
         };
 
         RequireData mRootData{this, files::getAppDirPath()};
-        std::unordered_map<std::string, v8::Persistent<v8::Value>> mModuleCache;
+        std::unordered_map<std::string, ModuleRecord> mModules;
+
         static void require(const v8::FunctionCallbackInfo<v8::Value> &args);
+        v8::MaybeLocal<v8::Value> inscope_loadModule(v8::Local<v8::Context> context, const std::string &modulePath);
+        bool isModuleChanged(const std::string &modulePath, ModuleRecord &record);
+        void collectDependents(const std::string &modulePath, std::unordered_set<std::string> &visited,
+                               std::vector<std::string> &postOrder);
         static void requireFinalizer(const v8::WeakCallbackInfo<RequireData> &info);
         static bool allowedPathStart(const std::string &path);
     };
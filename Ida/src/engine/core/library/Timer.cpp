@@ -2,148 +2,197 @@
 
 #include <iostream>
 
-#include "../engine.h"
+#include "../EmbedderSlots.h"
 #include "../argumentsHandler.h"
+#include "../engine.h"
 
 using namespace std;
 
 namespace core
 {
 
-    class TimerTask : public v8::Task
+    void Timer::onTimer(void *data, uint32_t timerId, bool isLastRun)
     {
-    private:
-        v8::Isolate *mIsolate;
-        TimerStartHandle *mTimerStartHandle;
-        uint32_t mTimerId;
-        double mDelayInSeconds;  // For intervals
-        bool mArgumentsPassedToNextTask = false;
-        v8::Persistent<v8::Value> *mArgv;
-        size_t mArgc;
-
-    public:
-        TimerTask(v8::Isolate *isolate, TimerStartHandle *timerStartHandle, int timerId, double delayInSeconds,
-                  v8::Persistent<v8::Value> *argv, size_t argc)
-            : mIsolate(isolate),
-              mTimerStartHandle(timerStartHandle),
-              mTimerId(timerId),
-              mDelayInSeconds(delayInSeconds),
-              mArgv(argv),
-              mArgc(argc)
-        {
-        }
-
-        ~TimerTask()
-        {
-            if (mArgumentsPassedToNextTask)
-            {
-                return;
-            }
-
-            for (size_t i = 0; i < mArgc; ++i)
-            {
-                mArgv[i].Reset();
-            }
-            delete[] mArgv;
-        }
-
-        void Run() override
+        auto timerStartHandle = static_cast<TimerStartHandle *>(data);
+        auto timer = timerStartHandle->timers.find(timerId);
+        if (timer == timerStartHandle->timers.end())
         {
-            auto timers = &mTimerStartHandle->timers;
-
-            // If timer was cleared
-            if (timers->find(mTimerId) == timers->end())
-            {
-                return;
-            }
+            return;
+        }
 
-            v8::HandleScope handleScope(mIsolate);
-            v8::Local<v8::Context> context = mIsolate->GetCurrentContext();
-            v8::Context::Scope context_scope(context);
+        // The timer may fire while another context is entered, so it enters the one that set it
+        v8::Isolate *isolate = v8::Isolate::GetCurrent();
+        v8::HandleScope handleScope(isolate);
+        v8::Local<v8::Context> context = timerStartHandle->context.Get(isolate);
+        v8::Context::Scope contextScope(context);
 
-            v8::Local<v8::Function> callback = mTimerStartHandle->timers[mTimerId].callback.Get(mIsolate);
+        v8::Local<v8::Function> callback = timer->second.callback.Get(isolate);
+        std::vector<v8::Local<v8::Value>> arguments;
+        arguments.reserve(timer->second.arguments.size());
+        for (const v8::Global<v8::Value> &argument : timer->second.arguments)
+        {
+            arguments.push_back(argument.Get(isolate));
+        }
 
-            if (mTimerStartHandle->timers[mTimerId].isInterval)
-            {
-                postDelayedTask(new TimerTask(mIsolate, mTimerStartHandle, mTimerId, mDelayInSeconds, mArgv, mArgc),
-                                mDelayInSeconds);
-                mArgumentsPassedToNextTask = true;
-            }
-            else
+        // The timer info may be erased by the callback, the histogram stays
+        LatencyRecorder &recorder = timerStartHandle->engine->getLatencyRecorder();
+        LatencyHistogram *latency = nullptr;
+        if (recorder.isEnabled())
+        {
+            if (!timer->second.latency)
             {
-                timers->erase(mTimerId);
+                timer->second.latency = inscope_getTimerLatency(isolate, timerStartHandle, callback);
             }
+            latency = timer->second.latency;
+        }
+        if (isLastRun)
+        {
+            timerStartHandle->timers.erase(timer);
+        }
 
-            vector<v8::Local<v8::Value>> localArguments(mArgc);
-            for (size_t i = 0; i < mArgc; ++i)
-            {
-                localArguments[i] = mArgv[i].Get(mIsolate); 
-            }
-            v8::Local<v8::Value> *localArgumentsPointer = localArguments.data();
-            inscope_tryCatch(
-                [&]() { return callback->Call(context, context->Global(), mArgc, localArgumentsPointer); });
+        int64_t startMicros = latency ? LatencyRecorder::now() : 0;
+        v8::MaybeLocal<v8::Value> result = inscope_tryCatch([&]() {
+            return callback->Call(context, context->Global(), static_cast<int>(arguments.size()), arguments.data());
+        });
+        if (latency)
+        {
+            recorder.record(*latency, startMicros, result.IsEmpty());
         }
-    };
+    }
 
     void Timer::inscope_bind(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> global)
     {
         // Bind setTimeout
-        global->Set(
-            v8::String::NewFromUtf8Literal(isolate, "setTimeout"),
-            v8::FunctionTemplate::New(isolate, Timer::setTimeout, v8::External::New(isolate, &mTimerStartHandle)));
-        global->Set(
-            v8::String::NewFromUtf8Literal(isolate, "clearTimeout"),
-            v8::FunctionTemplate::New(isolate, Timer::clearTimeout, v8::External::New(isolate, &mTimerStartHandle)));
+        global->Set(v8::String::NewFromUtf8Literal(isolate, "setTimeout"),
+                    v8::FunctionTemplate::New(isolate, Timer::setTimeout));
+        global->Set(v8::String::NewFromUtf8Literal(isolate, "clearTimeout"),
+                    v8::FunctionTemplate::New(isolate, Timer::clearTimeout));
 
         // Bind setInterval
-        global->Set(
-            v8::String::NewFromUtf8Literal(isolate, "setInterval"),
-            v8::FunctionTemplate::New(isolate, Timer::setInterval, v8::External::New(isolate, &mTimerStartHandle)));
-        global->Set(
-            v8::String::NewFromUtf8Literal(isolate, "clearInterval"),
-            v8::FunctionTemplate::New(isolate, Timer::clearTimeout, v8::External::New(isolate, &mTimerStartHandle)));
+        global->Set(v8::String::NewFromUtf8Literal(isolate, "setInterval"),
+                    v8::FunctionTemplate::New(isolate, Timer::setInterval));
+        global->Set(v8::String::NewFromUtf8Literal(isolate, "clearInterval"),
+                    v8::FunctionTemplate::New(isolate, Timer::clearInterval));
     }
 
-    // setTimeout implementation
-    void Timer::setTimeout(const v8::FunctionCallbackInfo<v8::Value> &args)
+    void Timer::addExternalReferences(std::vector<intptr_t> &references)
     {
-        v8::Isolate *isolate = args.GetIsolate();
-        v8::HandleScope handleScope(isolate);
+        references.push_back(reinterpret_cast<intptr_t>(setTimeout));
+        references.push_back(reinterpret_cast<intptr_t>(clearTimeout));
+        references.push_back(reinterpret_cast<intptr_t>(setInterval));
+        references.push_back(reinterpret_cast<intptr_t>(clearInterval));
+    }
 
-        if (args.Length() < 1 || !args[0]->IsFunction() || args.Length() > 1 && !args[1]->IsNumber())
+    Timer::~Timer()
+    {
+        if (mTimerStartHandle.engine)
         {
-            isolate->ThrowException(v8::Exception::TypeError(
-                v8::String::NewFromUtf8Literal(isolate, "Invalid arguments. Usage: setTimeout(callback[, delay]).")));
-            return;
+            mTimerStartHandle.engine->getTimerScheduler().cancelAll(&mTimerStartHandle);
         }
+    }
 
-        auto timerStartHandle = static_cast<TimerStartHandle *>(args.Data().As<v8::External>()->Value());
+    void Timer::inscope_attach(v8::Local<v8::Context> context)
+    {
+        mTimerStartHandle.engine = Engine::fromIsolate(context->GetIsolate());
+        mTimerStartHandle.context.Reset(context->GetIsolate(), context);
+        context->SetAlignedPointerInEmbedderData(static_cast<int>(ContextSlot::Timer), &mTimerStartHandle);
+    }
 
-        v8::Local<v8::Function> callback = args[0].As<v8::Function>();
-        int64_t delay = args.Length() > 1 ? args[1]->IntegerValue(isolate->GetCurrentContext()).ToChecked() : 0;
-        delay = delay > -1 ? delay : 0;
-        int timerId = timerStartHandle->nextTimerId++;
+    void Timer::inscope_detach(v8::Local<v8::Context> context)
+    {
+        context->SetAlignedPointerInEmbedderData(static_cast<int>(ContextSlot::Timer), nullptr);
+    }
+
+    TimerStartHandle *Timer::inscope_getTimerStartHandle(v8::Isolate *isolate)
+    {
+        auto timerStartHandle = static_cast<TimerStartHandle *>(
+            isolate->GetCurrentContext()->GetAlignedPointerFromEmbedderData(static_cast<int>(ContextSlot::Timer)));
+        if (!timerStartHandle)
+        {
+            inscope_ThrowError(isolate, "Timers are not available while the startup snapshot is created");
+        }
+        return timerStartHandle;
+    }
+
+    // Name of the callback with its location, e.g. "onTick (mods/a.js:12)", keying the latency of the timer
+    static std::string inscope_getCallbackName(v8::Isolate *isolate, v8::Local<v8::Function> callback)
+    {
+        v8::String::Utf8Value debugName(isolate, callback->GetDebugName());
+        std::string name = *debugName && **debugName ? *debugName : "(anonymous)";
+
+        v8::Local<v8::Value> resourceName = callback->GetScriptOrigin().ResourceName();
+        if (resourceName->IsString())
+        {
+            v8::String::Utf8Value path(isolate, resourceName);
+            name += " (" + std::string(*path) + ":" + std::to_string(callback->GetScriptLineNumber() + 1) + ")";
+        }
+        return name;
+    }
+
+    LatencyHistogram *Timer::inscope_getTimerLatency(v8::Isolate *isolate, TimerStartHandle *timerStartHandle,
+                                                     v8::Local<v8::Function> callback)
+    {
+        LatencyRecorder &recorder = timerStartHandle->engine->getLatencyRecorder();
+        int scriptId = callback->ScriptId();
+        if (scriptId == v8::UnboundScript::kNoScriptId)
+        {
+            // Native and bound functions have no position, their name is built on each call
+            return &recorder.getHistogram(LatencyCategory::Timer, inscope_getCallbackName(isolate, callback));
+        }
 
-        timerStartHandle->timers[timerId] = {timerId, false, v8::Global<v8::Function>(isolate, callback)};
+        FunctionPosition position{scriptId, callback->GetScriptLineNumber(), callback->GetScriptColumnNumber()};
+        LatencyHistogram *&latency = timerStartHandle->latencies[position];
+        if (!latency)
+        {
+            latency = &recorder.getHistogram(LatencyCategory::Timer, inscope_getCallbackName(isolate, callback));
+        }
+        return latency;
+    }
+
+    void Timer::inscope_startTimer(const v8::FunctionCallbackInfo<v8::Value> &args, bool isInterval,
+                                   int64_t defaultDelay)
+    {
+        v8::Isolate *isolate = args.GetIsolate();
+        auto timerStartHandle = inscope_getTimerStartHandle(isolate);
+        if (!timerStartHandle)
+        {
+            return;
+        }
 
+        v8::Local<v8::Function> callback = args[0].As<v8::Function>();
+        int64_t delay =
+            args.Length() > 1 ? args[1]->IntegerValue(isolate->GetCurrentContext()).ToChecked() : defaultDelay;
+        delay = delay > -1 ? delay : defaultDelay;
         double delayInSeconds = delay / 1000.0;
 
-        size_t argc;
-        v8::Persistent<v8::Value> *argv = inscope_newPersistentArguments(args, 2, &argc);
-        postDelayedTask(new TimerTask(isolate, timerStartHandle, timerId, delayInSeconds, argv, argc), delayInSeconds);
+        uint32_t timerId = timerStartHandle->nextTimerId++;
+        TimerInfo &timer = timerStartHandle->timers[timerId];
+        timer.callback.Reset(isolate, callback);
+        if (args.Length() > 2)
+        {
+            timer.arguments.reserve(args.Length() - 2);
+            for (int i = 2; i < args.Length(); i++)
+            {
+                timer.arguments.emplace_back(isolate, args[i]);
+            }
+        }
+
+        Engine *engine = timerStartHandle->engine;
+        timer.schedulerKey = engine->getTimerScheduler().add(engine->getTime(), delayInSeconds,
+                                                             isInterval ? delayInSeconds : 0, onTimer,
+                                                             timerStartHandle, timerId);
 
         args.GetReturnValue().Set(timerId);
     }
 
-    void Timer::clearTimeout(const v8::FunctionCallbackInfo<v8::Value> &args)
+    void Timer::inscope_clearTimer(const v8::FunctionCallbackInfo<v8::Value> &args, const char *usage)
     {
         v8::Isolate *isolate = args.GetIsolate();
-        v8::HandleScope handleScope(isolate);
 
         if (args.Length() < 1 || (!args[0]->IsNumber() && !args[0]->IsUndefined()))
         {
-            isolate->ThrowException(v8::Exception::TypeError(
-                v8::String::NewFromUtf8Literal(args.GetIsolate(), "Invalid arguments. Usage: clearTimeout(timerId).")));
+            isolate->ThrowException(
+                v8::Exception::TypeError(v8::String::NewFromUtf8(isolate, usage).ToLocalChecked()));
             return;
         }
 
@@ -152,18 +201,22 @@ namespace core
             return;
         }
 
-        auto timerStartHandle = static_cast<TimerStartHandle *>(args.Data().As<v8::External>()->Value());
-
-        int timerId = args[0]->Int32Value(args.GetIsolate()->GetCurrentContext()).ToChecked();
-        auto timers = &timerStartHandle->timers;
-
-        if (timers->find(timerId) != timers->end())
+        auto timerStartHandle = inscope_getTimerStartHandle(isolate);
+        if (!timerStartHandle)
+        {
+            return;
+        }
+        uint32_t timerId = args[0]->Uint32Value(isolate->GetCurrentContext()).FromJust();
+        auto timer = timerStartHandle->timers.find(timerId);
+        if (timer != timerStartHandle->timers.end())
         {
-            timers->erase(timerId);
+            timerStartHandle->engine->getTimerScheduler().cancel(timer->second.schedulerKey);
+            timerStartHandle->timers.erase(timer);
         }
     }
 
-    void Timer::setInterval(const v8::FunctionCallbackInfo<v8::Value> &args)
+    // setTimeout implementation
+    void Timer::setTimeout(const v8::FunctionCallbackInfo<v8::Value> &args)
     {
         v8::Isolate *isolate = args.GetIsolate();
         v8::HandleScope handleScope(isolate);
@@ -171,53 +224,37 @@ namespace core
         if (args.Length() < 1 || !args[0]->IsFunction() || args.Length() > 1 && !args[1]->IsNumber())
         {
             isolate->ThrowException(v8::Exception::TypeError(
-                v8::String::NewFromUtf8Literal(isolate, "Invalid arguments. Usage: setInterval(callback[, delay]).")));
+                v8::String::NewFromUtf8Literal(isolate, "Invalid arguments. Usage: setTimeout(callback[, delay]).")));
             return;
         }
 
-        auto timerStartHandle = static_cast<TimerStartHandle *>(args.Data().As<v8::External>()->Value());
-
-        v8::Local<v8::Function> callback = args[0].As<v8::Function>();
-        int64_t delay = args.Length() > 1 ? args[1]->IntegerValue(isolate->GetCurrentContext()).ToChecked() : 10;
-        delay = delay > -1 ? delay : 10;
-
-        int timerId = timerStartHandle->nextTimerId++;
-
-        timerStartHandle->timers[timerId] = {timerId, true, v8::Global<v8::Function>(isolate, callback)};
-
-        double delayInSeconds = delay / 1000.0;
-        size_t argc;
-        v8::Persistent<v8::Value> *argv = inscope_newPersistentArguments(args, 2, &argc);
-        postDelayedTask(new TimerTask(isolate, timerStartHandle, timerId, delayInSeconds, argv, argc), delayInSeconds);
+        inscope_startTimer(args, false, 0);
+    }
 
-        args.GetReturnValue().Set(timerId);
+    void Timer::clearTimeout(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        v8::HandleScope handleScope(args.GetIsolate());
+        inscope_clearTimer(args, "Invalid arguments. Usage: clearTimeout(timerId).");
     }
 
-    void Timer::clearInterval(const v8::FunctionCallbackInfo<v8::Value> &args)
+    void Timer::setInterval(const v8::FunctionCallbackInfo<v8::Value> &args)
     {
         v8::Isolate *isolate = args.GetIsolate();
         v8::HandleScope handleScope(isolate);
 
-        if (args.Length() < 1 || (!args[0]->IsNumber() && !args[0]->IsUndefined()))
+        if (args.Length() < 1 || !args[0]->IsFunction() || args.Length() > 1 && !args[1]->IsNumber())
         {
             isolate->ThrowException(v8::Exception::TypeError(
-                v8::String::NewFromUtf8Literal(isolate, "Invalid arguments. Usage: clearInterval(timerId).")));
-            return;
-        }
-
-        if (args[0]->IsUndefined())
-        {
+                v8::String::NewFromUtf8Literal(isolate, "Invalid arguments. Usage: setInterval(callback[, delay]).")));
             return;
         }
 
-        auto timerStartHandle = static_cast<TimerStartHandle *>(args.Data().As<v8::External>()->Value());
-
-        int timerId = args[0]->Int32Value(args.GetIsolate()->GetCurrentContext()).FromJust();
-        auto timers = &timerStartHandle->timers;
+        inscope_startTimer(args, true, 10);
+    }
 
-        if (timers->find(timerId) != timers->end())
-        {
-            timers->erase(timerId);
-        }
+    void Timer::clearInterval(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        v8::HandleScope handleScope(args.GetIsolate());
+        inscope_clearTimer(args, "Invalid arguments. Usage: clearInterval(timerId).");
     }
 }  // namespace core
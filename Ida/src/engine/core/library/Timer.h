@@ -2,33 +2,92 @@
 
 #include <v8.h>
 
+#include <cstddef>
+#include <functional>
 #include <unordered_map>
+#include <vector>
 
 namespace core
 {
+    class Engine;
+    class LatencyHistogram;
 
     struct TimerInfo
     {
-        int id;
-        bool isInterval;
         v8::Global<v8::Function> callback;
+        std::vector<v8::Global<v8::Value>> arguments;
+        // Key of the timer in the TimerScheduler of the engine
+        uint64_t schedulerKey = 0;
+        // Durations of the callback, owned by the LatencyRecorder of the engine. Resolved on the first run recorded.
+        LatencyHistogram *latency = nullptr;
+    };
+
+    // Position of a function in its script, which identifies the function literal of a timer callback
+    struct FunctionPosition
+    {
+        int scriptId;
+        int line;
+        int column;
+
+        bool operator==(const FunctionPosition &) const = default;
+    };
+
+    struct FunctionPositionHash
+    {
+        std::size_t operator()(const FunctionPosition &position) const
+        {
+            std::size_t hash = std::hash<int>{}(position.scriptId);
+            hash = hash * 31 + std::hash<int>{}(position.line);
+            return hash * 31 + std::hash<int>{}(position.column);
+        }
     };
 
     struct TimerStartHandle
     {
         uint32_t nextTimerId = 1;
         std::unordered_map<uint32_t, TimerInfo> timers;
+        // Engine running the timer tasks and the context they are called in, set by inscope_attach
+        Engine *engine = nullptr;
+        v8::Global<v8::Context> context;
+        // Latency histograms of the callbacks by their position, so the name is built once per function literal
+        std::unordered_map<FunctionPosition, LatencyHistogram *, FunctionPositionHash> latencies;
     };
 
     class Timer
     {
     public:
+        Timer() = default;
+        // Cancels the pending timers of this object
+        ~Timer();
+
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+
         // Bind functions to the global V8 object
-        void inscope_bind(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> global);
+        static void inscope_bind(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> global);
+
+        static void addExternalReferences(std::vector<intptr_t> &references);
+
+        // Makes this timer the one serving the timer functions called in the context
+        void inscope_attach(v8::Local<v8::Context> context);
+
+        // Leaves the context without a timer, so the timer functions throw. Used for the startup snapshot, as the
+        // pending timers could not be serialized.
+        static void inscope_detach(v8::Local<v8::Context> context);
 
     private:
         TimerStartHandle mTimerStartHandle;
 
+        // Throws and returns nullptr in a context without a timer, i.e. while the startup snapshot is created
+        static TimerStartHandle *inscope_getTimerStartHandle(v8::Isolate *isolate);
+
+        static void inscope_startTimer(const v8::FunctionCallbackInfo<v8::Value> &args, bool isInterval,
+                                       int64_t defaultDelay);
+        static void inscope_clearTimer(const v8::FunctionCallbackInfo<v8::Value> &args, const char *usage);
+        static void onTimer(void *data, uint32_t timerId, bool isLastRun);
+        static LatencyHistogram *inscope_getTimerLatency(v8::Isolate *isolate, TimerStartHandle *timerStartHandle,
+                                                         v8::Local<v8::Function> callback);
+
         static void setTimeout(const v8::FunctionCallbackInfo<v8::Value> &args);
         static void clearTimeout(const v8::FunctionCallbackInfo<v8::Value> &args);
         static void setInterval(const v8::FunctionCallbackInfo<v8::Value> &args);
@@ -0,0 +1,27 @@
+#include "Clock.h"
+
+#include <chrono>
+
+namespace core
+{
+    double RealTimeClock::now() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void VirtualClock::advance(double seconds)
+    {
+        if (seconds > 0)
+        {
+            advanceTo(now() + seconds);
+        }
+    }
+
+    void VirtualClock::advanceTo(double time)
+    {
+        double current = mTime.load(std::memory_order_relaxed);
+        while (time > current && !mTime.compare_exchange_weak(current, time, std::memory_order_relaxed))
+        {
+        }
+    }
+}  // namespace core
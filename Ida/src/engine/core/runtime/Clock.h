@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+
+namespace core
+{
+    /// @brief Source of the time for the timers, the tasks and performance.now. Times are monotonic seconds.
+    class Clock
+    {
+    public:
+        virtual ~Clock() = default;
+
+        virtual double now() const = 0;
+    };
+
+    class RealTimeClock : public Clock
+    {
+    public:
+        double now() const override;
+    };
+
+    /// @brief Clock advanced by the host, e.g. by the simulation step, so the scripts can run faster or slower than
+    /// real time. Starts at zero. The time only moves forward.
+    class VirtualClock : public Clock
+    {
+    public:
+        double now() const override
+        {
+            return mTime.load(std::memory_order_relaxed);
+        }
+
+        void advance(double seconds);
+
+        /// @brief Fast-forwards to the given time, e.g. Engine::getNextDeadline. Earlier times are ignored.
+        void advanceTo(double time);
+
+    private:
+        std::atomic<double> mTime = 0;
+    };
+}  // namespace core
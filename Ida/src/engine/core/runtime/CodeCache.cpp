@@ -0,0 +1,94 @@
+#include "CodeCache.h"
+
+#include "../../../../lib/md5/MD5.h"
+#include "../../../common/Logger.h"
+#include "../files.h"
+
+using namespace v8;
+
+namespace core
+{
+    constexpr const char *CacheFileExtension = ".jscache";
+
+    CodeCache::CodeCache(const std::string &cacheDirPath) : mCacheDirPath(files::toAbsolute(cacheDirPath))
+    {
+        files::createDirectories(mCacheDirPath);
+    }
+
+    CachedScript CodeCache::inscope_compile(Local<Context> context, Local<String> source, ScriptOrigin &origin,
+                                            const std::string &sourceText)
+    {
+        CachedScript result;
+        result.cacheKey = getCacheKey(sourceText);
+
+        std::string cacheFilePath = getCacheFilePath(result.cacheKey);
+        std::vector<uint8_t> cachedBytes;
+        if (files::exists(cacheFilePath))
+        {
+            try
+            {
+                cachedBytes = files::readAllBytes(cacheFilePath);
+            }
+            catch (std::exception &e)
+            {
+                Logger::wrn() << "Failed to read code cache " << cacheFilePath << "; " << e.what();
+                cachedBytes.clear();
+            }
+        }
+
+        if (cachedBytes.empty())
+        {
+            ScriptCompiler::Source scriptSource(source, origin);
+            result.script = ScriptCompiler::Compile(context, &scriptSource, ScriptCompiler::kNoCompileOptions);
+            return result;
+        }
+
+        // The source takes ownership of the CachedData object, but not of the buffer, which outlives the compilation
+        auto *cachedData = new ScriptCompiler::CachedData(cachedBytes.data(), static_cast<int>(cachedBytes.size()),
+                                                          ScriptCompiler::CachedData::BufferNotOwned);
+        ScriptCompiler::Source scriptSource(source, origin, cachedData);
+        result.script = ScriptCompiler::Compile(context, &scriptSource, ScriptCompiler::kConsumeCodeCache);
+        result.isCacheHit = !scriptSource.GetCachedData()->rejected;
+
+        if (!result.isCacheHit)
+        {
+            // V8 already compiled from source, the stale entry will be replaced after the run
+            Logger::dbg() << "Code cache rejected for " << cacheFilePath;
+            files::deleteFile(cacheFilePath);
+        }
+
+        return result;
+    }
+
+    void CodeCache::inscope_store(Local<Script> script, const std::string &cacheKey)
+    {
+        std::unique_ptr<ScriptCompiler::CachedData> cachedData(
+            ScriptCompiler::CreateCodeCache(script->GetUnboundScript()));
+        if (!cachedData || cachedData->length <= 0)
+        {
+            return;
+        }
+
+        std::string cacheFilePath = getCacheFilePath(cacheKey);
+        try
+        {
+            files::writeAllBytes(cacheFilePath, cachedData->data, static_cast<size_t>(cachedData->length));
+        }
+        catch (std::exception &e)
+        {
+            Logger::wrn() << "Failed to write code cache " << cacheFilePath << "; " << e.what();
+        }
+    }
+
+    std::string CodeCache::getCacheKey(const std::string &sourceText) const
+    {
+        Ida::MD5 md5;
+        md5.update(reinterpret_cast<const uint8_t *>(sourceText.data()), sourceText.length());
+        return md5.finalize() + "-" + std::to_string(ScriptCompiler::CachedDataVersionTag());
+    }
+
+    std::string CodeCache::getCacheFilePath(const std::string &cacheKey) const
+    {
+        return files::toAbsolute(cacheKey + CacheFileExtension, mCacheDirPath);
+    }
+}  // namespace core
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <v8.h>
+
+#include <string>
+
+namespace core
+{
+    struct CachedScript
+    {
+        v8::MaybeLocal<v8::Script> script;
+        std::string cacheKey;
+        bool isCacheHit = false;
+    };
+
+    /// @brief Disk-backed V8 code cache. Entries are keyed by the MD5 of the script source and the V8 cached data
+    /// version, so a changed script or an upgraded V8 simply misses the cache.
+    class CodeCache
+    {
+    public:
+        explicit CodeCache(const std::string &cacheDirPath);
+
+        /// @brief Compiles the script, consuming the cached code if there is a matching entry. Falls back to a full
+        /// compile when V8 rejects the cached data.
+        CachedScript inscope_compile(v8::Local<v8::Context> context, v8::Local<v8::String> source,
+                                     v8::ScriptOrigin &origin, const std::string &sourceText);
+
+        /// @brief Produces the code cache for the script and writes it to disk. Call after the script has run, so the
+        /// functions compiled lazily during the run are included.
+        void inscope_store(v8::Local<v8::Script> script, const std::string &cacheKey);
+
+    private:
+        std::string mCacheDirPath;
+
+        std::string getCacheKey(const std::string &sourceText) const;
+        std::string getCacheFilePath(const std::string &cacheKey) const;
+    };
+}  // namespace core
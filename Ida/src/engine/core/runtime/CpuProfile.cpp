@@ -0,0 +1,151 @@
+#include "CpuProfile.h"
+
+#include <fstream>
+
+#include "../../../common/Logger.h"
+#include "../files.h"
+#include "FileOutputStream.h"
+
+namespace core
+{
+    static std::string getFrameName(v8::Isolate *isolate, const v8::CpuProfileNode *node)
+    {
+        v8::String::Utf8Value functionName(isolate, node->GetFunctionName());
+        std::string frame = *functionName && **functionName ? *functionName : "(anonymous)";
+
+        v8::String::Utf8Value resourceName(isolate, node->GetScriptResourceName());
+        if (*resourceName && **resourceName)
+        {
+            frame += " (" + std::string(*resourceName) + ":" + std::to_string(node->GetLineNumber()) + ")";
+        }
+
+        // The separators of the collapsed format can't appear in the frame names
+        for (char &c : frame)
+        {
+            if (c == ';' || c == '\n')
+            {
+                c = '_';
+            }
+        }
+        return frame;
+    }
+
+    // Writes a line for each node with samples, the stack being the path from the root
+    static void writeCollapsedStacks(v8::Isolate *isolate, const v8::CpuProfileNode *node, std::string &stack,
+                                     std::ofstream &file)
+    {
+        size_t parentLength = stack.size();
+        if (node->GetParent())
+        {
+            if (parentLength > 0)
+            {
+                stack += ';';
+            }
+            stack += getFrameName(isolate, node);
+
+            if (node->GetHitCount() > 0)
+            {
+                file << stack << ' ' << node->GetHitCount() << '\n';
+            }
+        }
+
+        for (int i = 0; i < node->GetChildrenCount(); i++)
+        {
+            writeCollapsedStacks(isolate, node->GetChild(i), stack, file);
+        }
+        stack.resize(parentLength);
+    }
+
+    CpuProfileRecorder::CpuProfileRecorder(v8::Isolate *isolate) : mIsolate(isolate)
+    {
+    }
+
+    CpuProfileRecorder::~CpuProfileRecorder()
+    {
+        if (!mProfiler)
+        {
+            return;
+        }
+
+        if (mIsRecording)
+        {
+            v8::CpuProfile *profile = mProfiler->Stop(mProfileId);
+            if (profile)
+            {
+                profile->Delete();
+            }
+        }
+        mProfiler->Dispose();
+    }
+
+    bool CpuProfileRecorder::start(int samplingIntervalMicros)
+    {
+        if (mIsRecording)
+        {
+            return false;
+        }
+
+        if (!mProfiler)
+        {
+            mProfiler = v8::CpuProfiler::New(mIsolate, v8::kDebugNaming);
+        }
+
+        // The interval can only be changed while nothing is recorded
+        mProfiler->SetSamplingInterval(samplingIntervalMicros);
+        v8::CpuProfilingResult result = mProfiler->Start(v8::CpuProfilingOptions(
+            v8::kLeafNodeLineNumbers, v8::CpuProfilingOptions::kNoSampleLimit, samplingIntervalMicros));
+        if (result.status == v8::CpuProfilingStatus::kErrorTooManyProfilers)
+        {
+            Logger::err() << "CPU profile can't be started: too many profilers";
+            return false;
+        }
+
+        mProfileId = result.id;
+        mIsRecording = true;
+        return true;
+    }
+
+    bool CpuProfileRecorder::stop(const std::string &filePath, CpuProfileFormat format)
+    {
+        if (!mIsRecording)
+        {
+            return false;
+        }
+
+        mIsRecording = false;
+        v8::Isolate::Scope isolateScope(mIsolate);
+        v8::HandleScope handleScope(mIsolate);
+
+        v8::CpuProfile *profile = mProfiler->Stop(mProfileId);
+        if (!profile)
+        {
+            return false;
+        }
+
+        std::string fullPath = files::toAbsolute(filePath);
+        std::ofstream file(fullPath, std::ios::binary | std::ios::trunc);
+        if (file.is_open())
+        {
+            if (format == CpuProfileFormat::CpuProfile)
+            {
+                FileOutputStream stream(file);
+                profile->Serialize(&stream, v8::CpuProfile::kJSON);
+            }
+            else
+            {
+                std::string stack;
+                writeCollapsedStacks(mIsolate, profile->GetTopDownRoot(), stack, file);
+            }
+        }
+        profile->Delete();
+
+        if (!file)
+        {
+            Logger::err() << "Failed to write the CPU profile to " << fullPath;
+            return false;
+        }
+
+        Logger::inf() << "CPU profile written to " << fullPath;
+        return true;
+    }
+}  // namespace core
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <v8-profiler.h>
+#include <v8.h>
+
+#include <string>
+
+namespace core
+{
+    enum class CpuProfileFormat
+    {
+        // Chrome DevTools .cpuprofile JSON, opened by the Performance panel or speedscope
+        CpuProfile,
+        // One "frame;frame;frame count" line per call stack, the input of flamegraph.pl
+        CollapsedStacks
+    };
+
+    /// @brief Samples the JS call stacks of an isolate with v8::CpuProfiler. Records one profile at a time. The V8
+    /// profiler is created on the first start, so an engine that is never profiled doesn't pay for it.
+    class CpuProfileRecorder
+    {
+    public:
+        static constexpr int DefaultSamplingIntervalMicros = 1000;
+
+        explicit CpuProfileRecorder(v8::Isolate *isolate);
+        ~CpuProfileRecorder();
+
+        CpuProfileRecorder(const CpuProfileRecorder &) = delete;
+        CpuProfileRecorder &operator=(const CpuProfileRecorder &) = delete;
+
+        /// @brief Returns false if a profile is already being recorded
+        bool start(int samplingIntervalMicros = DefaultSamplingIntervalMicros);
+
+        /// @brief Stops the recording and writes the profile to the file. Returns false if nothing was recorded or the
+        /// file can't be written.
+        bool stop(const std::string &filePath, CpuProfileFormat format = CpuProfileFormat::CpuProfile);
+
+        bool isRecording() const
+        {
+            return mIsRecording;
+        }
+
+    private:
+        v8::Isolate *mIsolate;
+        v8::CpuProfiler *mProfiler = nullptr;
+        v8::ProfilerId mProfileId = 0;
+        bool mIsRecording = false;
+    };
+}  // namespace core
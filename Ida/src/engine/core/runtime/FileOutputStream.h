@@ -0,0 +1,35 @@
+#pragma once
+
+#include <v8-profiler.h>
+
+#include <fstream>
+
+namespace core
+{
+    // Streams the JSON serialization of a CPU profile or a heap snapshot to the file
+    class FileOutputStream : public v8::OutputStream
+    {
+    public:
+        explicit FileOutputStream(std::ofstream &file) : mFile(file)
+        {
+        }
+
+        void EndOfStream() override
+        {
+        }
+
+        int GetChunkSize() override
+        {
+            return 64 * 1024;
+        }
+
+        WriteResult WriteAsciiChunk(char *data, int size) override
+        {
+            mFile.write(data, size);
+            return mFile ? kContinue : kAbort;
+        }
+
+    private:
+        std::ofstream &mFile;
+    };
+}  // namespace core
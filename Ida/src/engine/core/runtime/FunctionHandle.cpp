@@ -0,0 +1,64 @@
+#include "FunctionHandle.h"
+
+#include "../engine.h"
+
+using namespace v8;
+
+namespace core
+{
+    FunctionHandle FunctionHandle::inscope_resolve(Isolate *isolate, Local<Object> receiver,
+                                                   const std::string &functionName)
+    {
+        FunctionHandle handle;
+        handle.mIsolate = isolate;
+        handle.mName = functionName;
+
+        Local<Context> context = isolate->GetCurrentContext();
+        Local<String> key =
+            String::NewFromUtf8(isolate, functionName.c_str(), NewStringType::kInternalized).ToLocalChecked();
+
+        Local<Value> value;
+        if (!receiver->Get(context, key).ToLocal(&value) || !value->IsFunction())
+        {
+            return handle;
+        }
+
+        handle.mReceiver.Reset(isolate, receiver);
+        handle.mFunction.Reset(isolate, value.As<Function>());
+        handle.mKey.Reset(isolate, key);
+        return handle;
+    }
+
+    bool FunctionHandle::inscope_isValid() const
+    {
+        if (mFunction.IsEmpty())
+        {
+            return false;
+        }
+
+        // The internalized key makes the read a fast property lookup
+        Local<Value> value;
+        return mReceiver.Get(mIsolate)->Get(mIsolate->GetCurrentContext(), mKey.Get(mIsolate)).ToLocal(&value) &&
+               value == mFunction.Get(mIsolate);
+    }
+
+    MaybeLocal<Value> FunctionHandle::inscope_call(int argc, Local<Value> *argv) const
+    {
+        if (!inscope_isValid())
+        {
+            return MaybeLocal<Value>();
+        }
+
+        Local<Context> context = mIsolate->GetCurrentContext();
+        Local<Function> function = mFunction.Get(mIsolate);
+        Local<Object> receiver = mReceiver.Get(mIsolate);
+        return inscope_tryCatch([&]() { return function->Call(context, receiver, argc, argv); });
+    }
+
+    void FunctionHandle::reset()
+    {
+        mReceiver.Reset();
+        mFunction.Reset();
+        mKey.Reset();
+    }
+}  // namespace core
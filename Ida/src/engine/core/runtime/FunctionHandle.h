@@ -0,0 +1,44 @@
+#pragma once
+
+#include <v8.h>
+
+#include <string>
+
+namespace core
+{
+    /// @brief JS function resolved once together with its receiver, to be called repeatedly without converting the name
+    /// and looking it up. Validity is checked by one property read per call, compared to the resolved function, so a
+    /// reassignment from JS is detected. The receiver's properties are left as the script defined them.
+    class FunctionHandle
+    {
+    public:
+        FunctionHandle() = default;
+        FunctionHandle(FunctionHandle &&) = default;
+        FunctionHandle &operator=(FunctionHandle &&) = default;
+
+        /// @brief Resolves the function property of the receiver. The handle is invalid if it's not a function.
+        static FunctionHandle inscope_resolve(v8::Isolate *isolate, v8::Local<v8::Object> receiver,
+                                              const std::string &functionName);
+
+        /// @brief False if the function was not found, or the property was reassigned since it was resolved
+        bool inscope_isValid() const;
+
+        /// @brief Calls the function with the receiver as this. Returns empty result if the handle is invalid or the
+        /// function has thrown.
+        v8::MaybeLocal<v8::Value> inscope_call(int argc, v8::Local<v8::Value> *argv) const;
+
+        const std::string &getName() const
+        {
+            return mName;
+        }
+
+        void reset();
+
+    private:
+        v8::Isolate *mIsolate = nullptr;
+        std::string mName;
+        v8::Global<v8::Object> mReceiver;
+        v8::Global<v8::Function> mFunction;
+        v8::Global<v8::String> mKey;
+    };
+}  // namespace core
@@ -0,0 +1,84 @@
+#include "HeapStats.h"
+
+#include <v8-profiler.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include "../../../common/Logger.h"
+#include "../files.h"
+#include "FileOutputStream.h"
+
+namespace core
+{
+    HeapStats sampleHeapStats(v8::Isolate *isolate)
+    {
+        v8::HeapStatistics heapStatistics;
+        isolate->GetHeapStatistics(&heapStatistics);
+
+        HeapStats stats;
+        stats.totalHeapSize = heapStatistics.total_heap_size();
+        stats.totalHeapSizeExecutable = heapStatistics.total_heap_size_executable();
+        stats.totalPhysicalSize = heapStatistics.total_physical_size();
+        stats.totalAvailableSize = heapStatistics.total_available_size();
+        stats.usedHeapSize = heapStatistics.used_heap_size();
+        stats.heapSizeLimit = heapStatistics.heap_size_limit();
+        stats.mallocedMemory = heapStatistics.malloced_memory();
+        stats.peakMallocedMemory = heapStatistics.peak_malloced_memory();
+        stats.externalMemory = heapStatistics.external_memory();
+        stats.nativeContextCount = heapStatistics.number_of_native_contexts();
+        stats.detachedContextCount = heapStatistics.number_of_detached_contexts();
+
+        size_t spaceCount = std::min(isolate->NumberOfHeapSpaces(), HeapStats::MaxSpaces);
+        for (size_t i = 0; i < spaceCount; i++)
+        {
+            v8::HeapSpaceStatistics spaceStatistics;
+            if (!isolate->GetHeapSpaceStatistics(&spaceStatistics, i))
+            {
+                continue;
+            }
+
+            HeapSpaceStats &space = stats.spaces[stats.spaceCount++];
+            space.name = spaceStatistics.space_name();
+            space.size = spaceStatistics.space_size();
+            space.usedSize = spaceStatistics.space_used_size();
+            space.availableSize = spaceStatistics.space_available_size();
+            space.physicalSize = spaceStatistics.physical_space_size();
+        }
+
+        return stats;
+    }
+
+    bool writeHeapSnapshot(v8::Isolate *isolate, const std::string &filePath)
+    {
+        std::string fullPath = files::toAbsolute(filePath);
+        std::ofstream file(fullPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            Logger::err() << "Failed to open the heap snapshot file " << fullPath;
+            return false;
+        }
+
+        v8::Isolate::Scope isolateScope(isolate);
+        v8::HandleScope handleScope(isolate);
+
+        const v8::HeapSnapshot *snapshot = isolate->GetHeapProfiler()->TakeHeapSnapshot();
+        if (!snapshot)
+        {
+            return false;
+        }
+
+        FileOutputStream stream(file);
+        snapshot->Serialize(&stream, v8::HeapSnapshot::kJSON);
+        const_cast<v8::HeapSnapshot *>(snapshot)->Delete();
+
+        if (!file)
+        {
+            Logger::err() << "Failed to write the heap snapshot to " << fullPath;
+            return false;
+        }
+
+        Logger::inf() << "Heap snapshot written to " << fullPath;
+        return true;
+    }
+}  // namespace core
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <v8.h>
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace core
+{
+    struct HeapSpaceStats
+    {
+        // Static string owned by V8, e.g. "old_space"
+        const char *name = nullptr;
+        size_t size = 0;
+        size_t usedSize = 0;
+        size_t availableSize = 0;
+        size_t physicalSize = 0;
+    };
+
+    /// @brief Memory of the V8 heap in bytes. Sampling doesn't allocate, so it can be done every frame.
+    struct HeapStats
+    {
+        // More than the spaces of any current V8 version
+        static constexpr size_t MaxSpaces = 16;
+
+        size_t totalHeapSize = 0;
+        size_t totalHeapSizeExecutable = 0;
+        size_t totalPhysicalSize = 0;
+        size_t totalAvailableSize = 0;
+        size_t usedHeapSize = 0;
+        size_t heapSizeLimit = 0;
+        // Memory allocated by V8 outside of the heap
+        size_t mallocedMemory = 0;
+        size_t peakMallocedMemory = 0;
+        // Memory of the ArrayBuffers and the other objects reported by the embedder
+        size_t externalMemory = 0;
+        size_t nativeContextCount = 0;
+        // Contexts that are not used anymore, but still retained. Growing after a reload means a leak.
+        size_t detachedContextCount = 0;
+
+        std::array<HeapSpaceStats, MaxSpaces> spaces;
+        size_t spaceCount = 0;
+    };
+
+    HeapStats sampleHeapStats(v8::Isolate *isolate);
+
+    /// @brief Writes a .heapsnapshot for the Memory panel of Chrome DevTools. Runs a full garbage collection first, and
+    /// blocks the thread for the duration, so it's meant for diagnosing leaks.
+    bool writeHeapSnapshot(v8::Isolate *isolate, const std::string &filePath);
+}  // namespace core
@@ -0,0 +1,76 @@
+#include "HostBuffer.h"
+
+using namespace v8;
+
+namespace core
+{
+    HostBuffer &HostBuffer::operator=(HostBuffer &&other)
+    {
+        if (this != &other)
+        {
+            release();
+            mIsolate = other.mIsolate;
+            mData = other.mData;
+            mByteLength = other.mByteLength;
+            mArrayBuffer = std::move(other.mArrayBuffer);
+            mDetachKey = std::move(other.mDetachKey);
+        }
+        return *this;
+    }
+
+    HostBuffer::~HostBuffer()
+    {
+        release();
+    }
+
+    HostBuffer HostBuffer::inscope_create(Isolate *isolate, void *data, size_t byteLength,
+                                          HostBufferReleaseCallback onReleased)
+    {
+        std::unique_ptr<BackingStore> backingStore =
+            onReleased ? ArrayBuffer::NewBackingStore(data, byteLength, deleteBackingStore,
+                                                      new HostBufferReleaseCallback(std::move(onReleased)))
+                       : ArrayBuffer::NewBackingStore(data, byteLength, BackingStore::EmptyDeleter, nullptr);
+        Local<ArrayBuffer> arrayBuffer = ArrayBuffer::New(isolate, std::move(backingStore));
+
+        // Only the holder of the key can detach the buffer, so JS can't take the host memory with transfer()
+        Local<Object> detachKey = Object::New(isolate);
+        arrayBuffer->SetDetachKey(detachKey);
+
+        HostBuffer hostBuffer;
+        hostBuffer.mIsolate = isolate;
+        hostBuffer.mData = data;
+        hostBuffer.mByteLength = byteLength;
+        hostBuffer.mArrayBuffer.Reset(isolate, arrayBuffer);
+        hostBuffer.mDetachKey.Reset(isolate, detachKey);
+        return hostBuffer;
+    }
+
+    Local<ArrayBuffer> HostBuffer::inscope_getArrayBuffer() const
+    {
+        return mArrayBuffer.Get(mIsolate);
+    }
+
+    void HostBuffer::release()
+    {
+        if (mArrayBuffer.IsEmpty())
+        {
+            return;
+        }
+
+        {
+            Isolate::Scope isolateScope(mIsolate);
+            HandleScope handleScope(mIsolate);
+            mArrayBuffer.Get(mIsolate)->Detach(mDetachKey.Get(mIsolate)).Check();
+        }
+
+        mArrayBuffer.Reset();
+        mDetachKey.Reset();
+    }
+
+    void HostBuffer::deleteBackingStore(void *data, size_t byteLength, void *deleterData)
+    {
+        auto *onReleased = static_cast<HostBufferReleaseCallback *>(deleterData);
+        (*onReleased)(data, byteLength);
+        delete onReleased;
+    }
+}  // namespace core
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <v8.h>
+
+#include <functional>
+
+namespace core
+{
+    // Called when V8 drops its last reference to the memory, possibly on a V8 background thread
+    using HostBufferReleaseCallback = std::function<void(void *data, size_t byteLength)>;
+
+    /// @brief Host-owned memory exposed to JS as an ArrayBuffer without copying, e.g. entity transforms shared with
+    /// the scripts as a Float32Array. The host keeps owning the memory: before freeing it, the host releases the
+    /// buffer, which detaches it so JS sees an empty buffer instead of a dangling one. The buffer can't be detached
+    /// or transferred from JS.
+    class HostBuffer
+    {
+    public:
+        HostBuffer() = default;
+        HostBuffer(HostBuffer &&) = default;
+        HostBuffer &operator=(HostBuffer &&other);
+
+        /// @brief Releases the buffer. Must be destroyed on the thread using the isolate.
+        ~HostBuffer();
+
+        /// @brief Wraps the memory, which must stay valid until release. The optional callback tells when V8 doesn't
+        /// reference the memory anymore, if the host prefers to free it only then.
+        static HostBuffer inscope_create(v8::Isolate *isolate, void *data, size_t byteLength,
+                                         HostBufferReleaseCallback onReleased = nullptr);
+
+        v8::Local<v8::ArrayBuffer> inscope_getArrayBuffer() const;
+
+        /// @brief False after release
+        bool isValid() const
+        {
+            return !mArrayBuffer.IsEmpty();
+        }
+
+        void *getData() const
+        {
+            return mData;
+        }
+
+        size_t getByteLength() const
+        {
+            return mByteLength;
+        }
+
+        /// @brief Detaches the ArrayBuffer, so the memory can be freed. The typed arrays over it become empty.
+        void release();
+
+    private:
+        v8::Isolate *mIsolate = nullptr;
+        void *mData = nullptr;
+        size_t mByteLength = 0;
+        v8::Global<v8::ArrayBuffer> mArrayBuffer;
+        v8::Global<v8::Object> mDetachKey;
+
+        static void deleteBackingStore(void *data, size_t byteLength, void *deleterData);
+    };
+}  // namespace core
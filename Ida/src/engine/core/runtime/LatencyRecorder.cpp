@@ -0,0 +1,140 @@
+#include "LatencyRecorder.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iomanip>
+
+namespace core
+{
+    size_t LatencyHistogram::getBucketIndex(uint64_t value)
+    {
+        if (value < SubBucketCount)
+        {
+            return static_cast<size_t>(value);
+        }
+
+        // The sub-bucket is given by the SubBucketBits bits under the highest set bit
+        int shift = std::bit_width(value) - 1 - SubBucketBits;
+        return static_cast<size_t>((shift + 1) * SubBucketCount + ((value >> shift) - SubBucketCount));
+    }
+
+    uint64_t LatencyHistogram::getBucketUpperBound(size_t index)
+    {
+        if (index < SubBucketCount)
+        {
+            return index;
+        }
+
+        int shift = static_cast<int>(index / SubBucketCount) - 1;
+        uint64_t lowerBound = (index % SubBucketCount + SubBucketCount) << shift;
+        return lowerBound + (uint64_t{1} << shift) - 1;
+    }
+
+    void LatencyHistogram::record(int64_t micros, bool threw)
+    {
+        uint64_t value = std::min(static_cast<uint64_t>(std::max<int64_t>(micros, 0)), MaxValue);
+        mBuckets[getBucketIndex(value)]++;
+        mCount++;
+        mExceptionCount += threw ? 1 : 0;
+        mTotal += static_cast<int64_t>(value);
+        mMax = std::max(mMax, static_cast<int64_t>(value));
+    }
+
+    int64_t LatencyHistogram::getValueAtPercentile(double percentile) const
+    {
+        if (mCount == 0)
+        {
+            return 0;
+        }
+
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * mCount)));
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < BucketCount; i++)
+        {
+            cumulative += mBuckets[i];
+            if (cumulative >= target)
+            {
+                return std::min(static_cast<int64_t>(getBucketUpperBound(i)), mMax);
+            }
+        }
+        return mMax;
+    }
+
+    void LatencyHistogram::reset()
+    {
+        mBuckets.fill(0);
+        mCount = 0;
+        mExceptionCount = 0;
+        mTotal = 0;
+        mMax = 0;
+    }
+
+    LatencyHistogram &LatencyRecorder::getHistogram(LatencyCategory category, std::string_view name)
+    {
+        HistogramMap &histograms = mHistograms[static_cast<size_t>(category)];
+        auto histogram = histograms.find(name);
+        if (histogram != histograms.end())
+        {
+            return histogram->second;
+        }
+        return histograms.emplace(std::string(name), LatencyHistogram()).first->second;
+    }
+
+    std::vector<LatencyStats> LatencyRecorder::getStats() const
+    {
+        std::vector<LatencyStats> result;
+        for (size_t category = 0; category < mHistograms.size(); category++)
+        {
+            for (const auto &[name, histogram] : mHistograms[category])
+            {
+                if (histogram.getCount() == 0)
+                {
+                    continue;
+                }
+
+                LatencyStats &stats = result.emplace_back();
+                stats.category = static_cast<LatencyCategory>(category);
+                stats.name = name;
+                stats.count = histogram.getCount();
+                stats.exceptionCount = histogram.getExceptionCount();
+                stats.totalMicros = histogram.getTotal();
+                stats.p50Micros = histogram.getValueAtPercentile(50);
+                stats.p99Micros = histogram.getValueAtPercentile(99);
+                stats.maxMicros = histogram.getMax();
+            }
+        }
+
+        std::sort(result.begin(), result.end(),
+                  [](const LatencyStats &a, const LatencyStats &b) { return a.totalMicros > b.totalMicros; });
+        return result;
+    }
+
+    void LatencyRecorder::dump(std::ostream &stream) const
+    {
+        static constexpr const char *CategoryNames[] = {"event", "function", "timer"};
+
+        stream << std::left << std::setw(10) << "category" << std::setw(40) << "name" << std::right << std::setw(10)
+               << "count" << std::setw(8) << "errors" << std::setw(12) << "total us" << std::setw(10) << "p50 us"
+               << std::setw(10) << "p99 us" << std::setw(10) << "max us" << "\n";
+
+        for (const LatencyStats &stats : getStats())
+        {
+            stream << std::left << std::setw(10) << CategoryNames[static_cast<size_t>(stats.category)]
+                   << std::setw(40) << stats.name << std::right << std::setw(10) << stats.count << std::setw(8)
+                   << stats.exceptionCount << std::setw(12) << stats.totalMicros << std::setw(10) << stats.p50Micros
+                   << std::setw(10) << stats.p99Micros << std::setw(10) << stats.maxMicros << "\n";
+        }
+    }
+
+    void LatencyRecorder::reset()
+    {
+        for (HistogramMap &histograms : mHistograms)
+        {
+            for (auto &[name, histogram] : histograms)
+            {
+                histogram.reset();
+            }
+        }
+    }
+}  // namespace core
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace core
+{
+    enum class LatencyCategory : uint8_t
+    {
+        // Events delivered through _handleEvent, keyed by the event name
+        Event,
+        // Functions called by the host, keyed by the function name
+        Function,
+        // Timer callbacks, keyed by the callback name and location
+        Timer
+    };
+
+    struct LatencyStats
+    {
+        LatencyCategory category;
+        std::string name;
+        uint64_t count = 0;
+        // Calls ending with an exception or a termination
+        uint64_t exceptionCount = 0;
+        int64_t totalMicros = 0;
+        int64_t p50Micros = 0;
+        int64_t p99Micros = 0;
+        int64_t maxMicros = 0;
+    };
+
+    /// @brief Log-linear histogram of durations in microseconds, in the manner of HdrHistogram. Each power of two is
+    /// split in 16 buckets, so the percentiles are within 1/16 of the real value. Recording is a few arithmetic
+    /// operations and never allocates.
+    class LatencyHistogram
+    {
+    public:
+        static constexpr int SubBucketBits = 4;
+        static constexpr int SubBucketCount = 1 << SubBucketBits;
+        // Longer durations (over an hour) are counted in the last bucket
+        static constexpr uint64_t MaxValue = UINT32_MAX;
+        static constexpr size_t BucketCount = (32 - SubBucketBits + 1) * SubBucketCount;
+
+        void record(int64_t micros, bool threw);
+
+        /// @brief Highest value of the bucket containing the percentile, clamped to the max recorded value
+        int64_t getValueAtPercentile(double percentile) const;
+
+        uint64_t getCount() const
+        {
+            return mCount;
+        }
+
+        uint64_t getExceptionCount() const
+        {
+            return mExceptionCount;
+        }
+
+        int64_t getTotal() const
+        {
+            return mTotal;
+        }
+
+        int64_t getMax() const
+        {
+            return mMax;
+        }
+
+        void reset();
+
+    private:
+        std::array<uint32_t, BucketCount> mBuckets{};
+        uint64_t mCount = 0;
+        uint64_t mExceptionCount = 0;
+        int64_t mTotal = 0;
+        int64_t mMax = 0;
+
+        static size_t getBucketIndex(uint64_t value);
+        static uint64_t getBucketUpperBound(size_t index);
+    };
+
+    /// @brief Histograms of the script calls made by the host, so the costly event types or timers can be found in
+    /// production builds. The histograms are created on the first call of each key and never removed, so their
+    /// addresses can be kept by the callers.
+    class LatencyRecorder
+    {
+    public:
+        static int64_t now()
+        {
+            using namespace std::chrono;
+            return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+        }
+
+        void setEnabled(bool isEnabled)
+        {
+            mIsEnabled = isEnabled;
+        }
+
+        bool isEnabled() const
+        {
+            return mIsEnabled;
+        }
+
+        /// @brief Returns the histogram of the key, creating it on the first call
+        LatencyHistogram &getHistogram(LatencyCategory category, std::string_view name);
+
+        /// @brief Records the time since the start, read with now()
+        void record(LatencyHistogram &histogram, int64_t startMicros, bool threw)
+        {
+            if (mIsEnabled)
+            {
+                histogram.record(now() - startMicros, threw);
+            }
+        }
+
+        void record(LatencyCategory category, std::string_view name, int64_t startMicros, bool threw)
+        {
+            if (mIsEnabled)
+            {
+                getHistogram(category, name).record(now() - startMicros, threw);
+            }
+        }
+
+        /// @brief Stats of the keys called at least once, sorted by the total time
+        std::vector<LatencyStats> getStats() const;
+
+        /// @brief Writes the stats as a table, the costliest keys first
+        void dump(std::ostream &stream) const;
+
+        /// @brief Clears the histograms, keeping the keys
+        void reset();
+
+    private:
+        struct StringViewHash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view value) const
+            {
+                return std::hash<std::string_view>{}(value);
+            }
+        };
+
+        using HistogramMap = std::unordered_map<std::string, LatencyHistogram, StringViewHash, std::equal_to<>>;
+
+        std::array<HistogramMap, 3> mHistograms;
+        bool mIsEnabled = true;
+    };
+}  // namespace core
@@ -0,0 +1,42 @@
+#include "PerformanceTimeline.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace core
+{
+    void PerformanceTimeline::add(PerformanceEntryType type, std::string_view name, double startTime, double duration)
+    {
+        PerformanceEntry &entry = mEntries[mHead];
+        size_t nameLength = std::min(name.size(), PerformanceEntry::MaxNameLength);
+        std::memcpy(entry.name, name.data(), nameLength);
+        entry.name[nameLength] = '\0';
+        entry.type = type;
+        entry.startTime = startTime;
+        entry.duration = duration;
+
+        mHead = (mHead + 1) % Capacity;
+        if (mSize < Capacity)
+        {
+            mSize++;
+        }
+        else
+        {
+            mOverwrittenCount++;
+        }
+    }
+
+    bool PerformanceTimeline::findMark(std::string_view name, double &startTime) const
+    {
+        for (size_t i = 1; i <= mSize; i++)
+        {
+            const PerformanceEntry &entry = mEntries[(mHead + Capacity - i) % Capacity];
+            if (entry.type == PerformanceEntryType::Mark && entry.getName() == name)
+            {
+                startTime = entry.startTime;
+                return true;
+            }
+        }
+        return false;
+    }
+}  // namespace core
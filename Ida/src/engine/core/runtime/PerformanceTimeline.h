@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace core
+{
+    enum class PerformanceEntryType : uint8_t
+    {
+        Mark,
+        Measure
+    };
+
+    struct PerformanceEntry
+    {
+        // Longer names are truncated
+        static constexpr size_t MaxNameLength = 47;
+
+        char name[MaxNameLength + 1];
+        PerformanceEntryType type;
+        // Milliseconds since the time origin of the engine
+        double startTime;
+        double duration;
+
+        std::string_view getName() const
+        {
+            return name;
+        }
+    };
+
+    /// @brief Fixed-size ring buffer of the performance.mark and performance.measure entries. When full, the oldest
+    /// entries are overwritten, so recording never allocates. Shared by all the contexts of the engine, and drained by
+    /// the host profiler.
+    class PerformanceTimeline
+    {
+    public:
+        static constexpr size_t Capacity = 1024;
+
+        void add(PerformanceEntryType type, std::string_view name, double startTime, double duration);
+
+        /// @brief Start time of the latest mark with the name. Returns false if there is no such mark in the buffer.
+        bool findMark(std::string_view name, double &startTime) const;
+
+        /// @brief Calls the function for each entry, from the oldest to the newest
+        template <typename Fn>
+        void forEach(Fn &&fn) const
+        {
+            for (size_t i = 0; i < mSize; i++)
+            {
+                fn(mEntries[(mHead + Capacity - mSize + i) % Capacity]);
+            }
+        }
+
+        /// @brief Calls the function for each entry like forEach, then removes them
+        template <typename Fn>
+        void drain(Fn &&fn)
+        {
+            forEach(fn);
+            clear();
+        }
+
+        void clear()
+        {
+            mSize = 0;
+        }
+
+        size_t size() const
+        {
+            return mSize;
+        }
+
+        /// @brief Entries overwritten before they were drained
+        uint64_t getOverwrittenCount() const
+        {
+            return mOverwrittenCount;
+        }
+
+    private:
+        std::array<PerformanceEntry, Capacity> mEntries;
+        // Index of the next entry to write
+        size_t mHead = 0;
+        size_t mSize = 0;
+        uint64_t mOverwrittenCount = 0;
+    };
+}  // namespace core
@@ -0,0 +1,133 @@
+#include "PooledAllocator.h"
+
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+
+namespace core
+{
+    PooledAllocator::PooledAllocator(size_t maxPooledBytes) : mMaxPooledBytes(maxPooledBytes)
+    {
+    }
+
+    PooledAllocator::~PooledAllocator()
+    {
+        trim();
+    }
+
+    int PooledAllocator::getSizeClass(size_t length)
+    {
+        if (length > MaxClassSize)
+        {
+            return -1;
+        }
+        if (length <= MinClassSize)
+        {
+            return 0;
+        }
+
+        return std::bit_width(length - 1) - std::bit_width(MinClassSize - 1);
+    }
+
+    size_t PooledAllocator::getClassSize(int sizeClass)
+    {
+        return MinClassSize << sizeClass;
+    }
+
+    void *PooledAllocator::Allocate(size_t length)
+    {
+        void *data = AllocateUninitialized(length);
+        if (data)
+        {
+            std::memset(data, 0, length);
+        }
+        return data;
+    }
+
+    void *PooledAllocator::AllocateUninitialized(size_t length)
+    {
+        int sizeClass = getSizeClass(length);
+        void *data = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStats.totalAllocations++;
+            mStats.liveAllocations++;
+            mStats.liveBytes += length;
+
+            if (sizeClass >= 0 && !mPools[sizeClass].empty())
+            {
+                data = mPools[sizeClass].back();
+                mPools[sizeClass].pop_back();
+                mStats.pooledBytes -= getClassSize(sizeClass);
+                mStats.poolHits++;
+                return data;
+            }
+        }
+
+        data = std::malloc(sizeClass >= 0 ? getClassSize(sizeClass) : length);
+        if (!data)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStats.liveAllocations--;
+            mStats.liveBytes -= length;
+        }
+        return data;
+    }
+
+    void PooledAllocator::Free(void *data, size_t length)
+    {
+        if (!data)
+        {
+            return;
+        }
+
+        int sizeClass = getSizeClass(length);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStats.liveAllocations--;
+            mStats.liveBytes -= length;
+
+            if (sizeClass >= 0 && mStats.pooledBytes + getClassSize(sizeClass) <= mMaxPooledBytes)
+            {
+                mPools[sizeClass].push_back(data);
+                mStats.pooledBytes += getClassSize(sizeClass);
+                return;
+            }
+        }
+
+        std::free(data);
+    }
+
+    ArrayBufferStats PooledAllocator::sampleStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto now = std::chrono::steady_clock::now();
+        double elapsedSeconds = std::chrono::duration<double>(now - mSampleTime).count();
+        if (elapsedSeconds > 0)
+        {
+            mStats.allocationsPerSecond = (mStats.totalAllocations - mSampledAllocations) / elapsedSeconds;
+        }
+        mSampledAllocations = mStats.totalAllocations;
+        mSampleTime = now;
+
+        return mStats;
+    }
+
+    void PooledAllocator::trim(size_t retainedBytes)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // The biggest blocks go first, they release the most memory per free
+        for (int sizeClass = SizeClassCount - 1; sizeClass >= 0 && mStats.pooledBytes > retainedBytes; sizeClass--)
+        {
+            std::vector<void *> &pool = mPools[sizeClass];
+            while (!pool.empty() && mStats.pooledBytes > retainedBytes)
+            {
+                std::free(pool.back());
+                pool.pop_back();
+                mStats.pooledBytes -= getClassSize(sizeClass);
+            }
+        }
+    }
+}  // namespace core
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <v8.h>
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace core
+{
+    struct ArrayBufferStats
+    {
+        size_t liveBytes = 0;
+        size_t liveAllocations = 0;
+        // Freed blocks kept for reuse
+        size_t pooledBytes = 0;
+        uint64_t totalAllocations = 0;
+        // Allocations served from the pools
+        uint64_t poolHits = 0;
+        // Since the previous sample
+        double allocationsPerSecond = 0;
+    };
+
+    /// @brief ArrayBuffer allocator keeping the freed small blocks in power of two size class pools, so the typed
+    /// arrays created every frame reuse the same memory instead of going through malloc. Blocks over the biggest size
+    /// class are not pooled. The pools are bounded by a byte budget. Backing stores may be freed on the V8 background
+    /// threads, so all the methods are thread-safe.
+    class PooledAllocator : public v8::ArrayBuffer::Allocator
+    {
+    public:
+        explicit PooledAllocator(size_t maxPooledBytes);
+        ~PooledAllocator() override;
+
+        void *Allocate(size_t length) override;
+        void *AllocateUninitialized(size_t length) override;
+        void Free(void *data, size_t length) override;
+
+        /// @brief Returns the counters, computing the allocation rate since the previous call
+        ArrayBufferStats sampleStats();
+
+        /// @brief Releases the pooled blocks over the retained byte count back to the system
+        void trim(size_t retainedBytes = 0);
+
+    private:
+        static constexpr size_t MinClassSize = 16;
+        static constexpr size_t MaxClassSize = 64 * 1024;
+        static constexpr int SizeClassCount = 13;
+
+        std::mutex mMutex;
+        std::array<std::vector<void *>, SizeClassCount> mPools;
+        size_t mMaxPooledBytes;
+        ArrayBufferStats mStats;
+        uint64_t mSampledAllocations = 0;
+        std::chrono::steady_clock::time_point mSampleTime = std::chrono::steady_clock::now();
+
+        // Returns -1 for the blocks that are too big to be pooled
+        static int getSizeClass(size_t length);
+        static size_t getClassSize(int sizeClass);
+    };
+}  // namespace core
@@ -2,41 +2,42 @@
 
 #include <iostream>
 
+#include "../EmbedderSlots.h"
+
 using namespace v8;
 
 namespace core
 {
-
-    struct RejectedPromise
-    {
-        v8::Global<v8::Promise> promise;
-        v8::Global<v8::Value> reason;
-    };
-
-    static std::map<uint64_t, RejectedPromise> mRejectedPromises;
-    static std::atomic<uint64_t> mNextId(1);
-    static Isolate *mIsolate;
-
-    PromiseRejectionHandler::PromiseRejectionHandler(Isolate *isolate)
+    PromiseRejectionHandler::PromiseRejectionHandler(Isolate *isolate) : mIsolate(isolate)
     {
-        mIsolate = isolate;
+        mIsolate->SetData(static_cast<uint32_t>(IsolateSlot::PromiseRejectionHandler), this);
         mIsolate->SetPromiseRejectCallback(promiseRejectCallback);
     }
 
     PromiseRejectionHandler::~PromiseRejectionHandler()
     {
         mIsolate->SetPromiseRejectCallback(nullptr);
+        mIsolate->SetData(static_cast<uint32_t>(IsolateSlot::PromiseRejectionHandler), nullptr);
         for (auto &[id, entry] : mRejectedPromises)
         {
             entry.promise.Reset();
             entry.reason.Reset();
         }
         mRejectedPromises.clear();
-        mNextId = 1;
-        mIsolate = nullptr;
     }
 
     void PromiseRejectionHandler::promiseRejectCallback(PromiseRejectMessage message)
+    {
+        Isolate *isolate = Isolate::GetCurrent();
+        auto *handler = static_cast<PromiseRejectionHandler *>(
+            isolate->GetData(static_cast<uint32_t>(IsolateSlot::PromiseRejectionHandler)));
+        if (handler)
+        {
+            handler->onPromiseRejected(message);
+        }
+    }
+
+    void PromiseRejectionHandler::onPromiseRejected(PromiseRejectMessage &message)
     {
         HandleScope handle_scope(mIsolate);
 
@@ -48,7 +49,7 @@ namespace core
 
         if (event == PromiseRejectEvent::kPromiseRejectWithNoHandler)
         {
-            uint64_t id = mNextId.fetch_add(1, std::memory_order_relaxed);
+            uint64_t id = mNextId++;
             promise->SetPrivate(mIsolate->GetCurrentContext(), promiseIdKey, BigInt::NewFromUnsigned(mIsolate, id))
                 .Check();
 
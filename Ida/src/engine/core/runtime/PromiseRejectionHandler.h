@@ -15,7 +15,18 @@ namespace core
         void checkUnhandledRejections();
 
     private:
+        struct RejectedPromise
+        {
+            v8::Global<v8::Promise> promise;
+            v8::Global<v8::Value> reason;
+        };
+
+        v8::Isolate *mIsolate;
+        std::map<uint64_t, RejectedPromise> mRejectedPromises;
+        uint64_t mNextId = 1;
+
         void inscope_outputUnhandledRejection(v8::Local<v8::Value> reason);
+        void onPromiseRejected(v8::PromiseRejectMessage &message);
         static void promiseRejectCallback(v8::PromiseRejectMessage message);
     };
 }  // namespace core
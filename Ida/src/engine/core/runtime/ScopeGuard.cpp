@@ -3,7 +3,8 @@
 namespace core
 {
 
-    static ScopeGuard *mInstance = nullptr;
+    // One guard per thread, so engines running on different threads don't share it
+    static thread_local ScopeGuard *mInstance = nullptr;
 
     ScopeGuard::ScopeGuard()
     {
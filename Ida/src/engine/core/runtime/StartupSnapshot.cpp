@@ -0,0 +1,80 @@
+#include "StartupSnapshot.h"
+
+#include "../../../common/Logger.h"
+#include "../files.h"
+#include "../library/Console.h"
+#include "../library/Performance.h"
+#include "../library/Profiler.h"
+#include "../library/Require.h"
+#include "../library/Timer.h"
+
+namespace core
+{
+    bool StartupSnapshot::load(const std::string &blobPath)
+    {
+        std::string fullPath = files::toAbsolute(blobPath);
+        if (!files::exists(fullPath))
+        {
+            Logger::wrn() << "Startup snapshot not found: " << fullPath;
+            return false;
+        }
+
+        try
+        {
+            mBlobBytes = files::readAllBytes(fullPath);
+        }
+        catch (std::exception &e)
+        {
+            Logger::wrn() << "Failed to read startup snapshot: " << e.what();
+            return false;
+        }
+
+        mStartupData = {reinterpret_cast<const char *>(mBlobBytes.data()), static_cast<int>(mBlobBytes.size())};
+        if (!mStartupData.IsValid())
+        {
+            Logger::wrn() << "Startup snapshot is invalid or was created by a different V8 version: " << fullPath;
+            mBlobBytes.clear();
+            mStartupData = {nullptr, 0};
+            return false;
+        }
+
+        return true;
+    }
+
+    bool StartupSnapshot::save(const v8::StartupData &blob, const std::string &blobPath)
+    {
+        if (blob.data == nullptr || blob.raw_size <= 0)
+        {
+            return false;
+        }
+
+        try
+        {
+            files::writeAllBytes(blobPath, reinterpret_cast<const uint8_t *>(blob.data),
+                                 static_cast<size_t>(blob.raw_size));
+        }
+        catch (std::exception &e)
+        {
+            Logger::err() << "Failed to write startup snapshot: " << e.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    const intptr_t *StartupSnapshot::getExternalReferences()
+    {
+        static const std::vector<intptr_t> references = []() {
+            std::vector<intptr_t> result;
+            Console::addExternalReferences(result);
+            Timer::addExternalReferences(result);
+            Performance::addExternalReferences(result);
+            Profiler::addExternalReferences(result);
+            Require::addExternalReferences(result);
+            result.push_back(0);
+            return result;
+        }();
+
+        return references.data();
+    }
+}  // namespace core
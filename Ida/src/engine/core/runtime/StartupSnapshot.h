@@ -0,0 +1,34 @@
+#pragma once
+
+#include <v8.h>
+
+#include <string>
+#include <vector>
+
+namespace core
+{
+    /// @brief Index of the bootstrapped context (library bindings + global.js) in the startup snapshot
+    constexpr size_t BootstrappedContextIndex = 0;
+
+    class StartupSnapshot
+    {
+    public:
+        /// @brief Reads the snapshot blob from disk. Returns false if it's missing or doesn't pass the V8 checksum.
+        bool load(const std::string &blobPath);
+
+        const v8::StartupData *getStartupData() const
+        {
+            return &mStartupData;
+        }
+
+        static bool save(const v8::StartupData &blob, const std::string &blobPath);
+
+        /// @brief Null-terminated list of the native callbacks bound into the global template. Must be the same when
+        /// the snapshot is created and when it's deserialized.
+        static const intptr_t *getExternalReferences();
+
+    private:
+        std::vector<uint8_t> mBlobBytes;
+        v8::StartupData mStartupData{nullptr, 0};
+    };
+}  // namespace core
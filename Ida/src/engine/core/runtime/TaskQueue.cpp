@@ -0,0 +1,137 @@
+#include "TaskQueue.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace core
+{
+    // Heap ordering for a min-heap: earliest deadline on top, post order between equal deadlines
+    bool TaskQueue::isLater(const Entry &a, const Entry &b)
+    {
+        return a.deadline > b.deadline || (a.deadline == b.deadline && a.sequence > b.sequence);
+    }
+
+    void TaskQueue::post(std::unique_ptr<v8::Task> task, double now, const void *owner)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mImmediateTasks.push_back({now, mNextSequence++, std::move(task), owner});
+    }
+
+    void TaskQueue::postDelayed(std::unique_ptr<v8::Task> task, double now, double delayInSeconds, const void *owner)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDelayedTasks.push_back({now + delayInSeconds, mNextSequence++, std::move(task), owner});
+        std::push_heap(mDelayedTasks.begin(), mDelayedTasks.end(), isLater);
+    }
+
+    std::unique_ptr<v8::Task> TaskQueue::popReady(TaskPolicy policy, double now)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        bool isImmediateReady = !mImmediateTasks.empty();
+        bool isDelayedReady = !mDelayedTasks.empty() && mDelayedTasks.front().deadline <= now;
+
+        if (isImmediateReady && isDelayedReady)
+        {
+            if (policy == TaskPolicy::ImmediateFirst || !isLater(mImmediateTasks.front(), mDelayedTasks.front()))
+            {
+                return popImmediate();
+            }
+            return popDelayed();
+        }
+
+        if (isImmediateReady)
+        {
+            return popImmediate();
+        }
+        if (isDelayedReady)
+        {
+            return popDelayed();
+        }
+
+        return nullptr;
+    }
+
+    double TaskQueue::getNextReadyDeadline(TaskPolicy policy, double now) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        double deadline = std::numeric_limits<double>::infinity();
+        if (!mImmediateTasks.empty())
+        {
+            deadline = policy == TaskPolicy::ImmediateFirst ? -std::numeric_limits<double>::infinity()
+                                                            : mImmediateTasks.front().deadline;
+        }
+        if (!mDelayedTasks.empty() && mDelayedTasks.front().deadline <= now)
+        {
+            deadline = std::min(deadline, mDelayedTasks.front().deadline);
+        }
+        return deadline;
+    }
+
+    double TaskQueue::getNextDeadline() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        double deadline = std::numeric_limits<double>::infinity();
+        if (!mImmediateTasks.empty())
+        {
+            deadline = mImmediateTasks.front().deadline;
+        }
+        if (!mDelayedTasks.empty())
+        {
+            deadline = std::min(deadline, mDelayedTasks.front().deadline);
+        }
+        return deadline;
+    }
+
+    size_t TaskQueue::countReady(double now) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mImmediateTasks.size() + countReadyDelayed(0, now);
+    }
+
+    void TaskQueue::cancel(const void *owner)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto isOwned = [owner](const Entry &entry) { return entry.owner == owner; };
+        std::erase_if(mImmediateTasks, isOwned);
+        if (std::erase_if(mDelayedTasks, isOwned) > 0)
+        {
+            std::make_heap(mDelayedTasks.begin(), mDelayedTasks.end(), isLater);
+        }
+    }
+
+    void TaskQueue::clear()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mImmediateTasks.clear();
+        mDelayedTasks.clear();
+    }
+
+    std::unique_ptr<v8::Task> TaskQueue::popImmediate()
+    {
+        std::unique_ptr<v8::Task> task = std::move(mImmediateTasks.front().task);
+        mImmediateTasks.pop_front();
+        return task;
+    }
+
+    std::unique_ptr<v8::Task> TaskQueue::popDelayed()
+    {
+        std::pop_heap(mDelayedTasks.begin(), mDelayedTasks.end(), isLater);
+        std::unique_ptr<v8::Task> task = std::move(mDelayedTasks.back().task);
+        mDelayedTasks.pop_back();
+        return task;
+    }
+
+    size_t TaskQueue::countReadyDelayed(size_t heapIndex, double now) const
+    {
+        // Children of a task that is not ready are not ready either, so only the ready part of the heap is visited
+        if (heapIndex >= mDelayedTasks.size() || mDelayedTasks[heapIndex].deadline > now)
+        {
+            return 0;
+        }
+
+        return 1 + countReadyDelayed(heapIndex * 2 + 1, now) + countReadyDelayed(heapIndex * 2 + 2, now);
+    }
+}  // namespace core
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <v8.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace core
+{
+    enum class TaskPolicy
+    {
+        // Runs the ready task with the earliest deadline first. The deadline of an immediate task is its post time, so
+        // overdue timers are not starved by a stream of immediate tasks.
+        EarliestDeadlineFirst,
+        // Runs all ready immediate tasks before any timer
+        ImmediateFirst
+    };
+
+    /// @brief Engine-owned queue of the tasks posted by the library objects. Delayed tasks are kept in a min-heap by
+    /// deadline. Times are monotonic seconds.
+    class TaskQueue
+    {
+    public:
+        // The owner is an opaque tag of the object the task belongs to, used by cancel
+        void post(std::unique_ptr<v8::Task> task, double now, const void *owner = nullptr);
+
+        void postDelayed(std::unique_ptr<v8::Task> task, double now, double delayInSeconds,
+                         const void *owner = nullptr);
+
+        /// @brief Removes the next task to run at the given time according to the policy, or returns nullptr if no
+        /// task is ready
+        std::unique_ptr<v8::Task> popReady(TaskPolicy policy, double now);
+
+        /// @brief Deadline of the task popReady would return, used to order the tasks with the timers. Immediate tasks
+        /// report negative infinity with the ImmediateFirst policy. Infinity if no task is ready.
+        double getNextReadyDeadline(TaskPolicy policy, double now) const;
+
+        /// @brief Earliest deadline of all the pending tasks, or infinity if there are none
+        double getNextDeadline() const;
+
+        /// @brief Number of tasks that are ready to run at the given time
+        size_t countReady(double now) const;
+
+        /// @brief Drops the pending tasks of the owner without running them
+        void cancel(const void *owner);
+
+        /// @brief Drops all pending tasks. Must be called before the isolate is disposed, as tasks may hold handles.
+        void clear();
+
+    private:
+        struct Entry
+        {
+            double deadline;
+            uint64_t sequence;
+            std::unique_ptr<v8::Task> task;
+            const void *owner;
+        };
+
+        mutable std::mutex mMutex;
+        std::deque<Entry> mImmediateTasks;
+        std::vector<Entry> mDelayedTasks;
+        uint64_t mNextSequence = 0;
+
+        static bool isLater(const Entry &a, const Entry &b);
+
+        std::unique_ptr<v8::Task> popImmediate();
+        std::unique_ptr<v8::Task> popDelayed();
+        size_t countReadyDelayed(size_t heapIndex, double now) const;
+    };
+}  // namespace core
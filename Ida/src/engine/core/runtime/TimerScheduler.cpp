@@ -0,0 +1,186 @@
+#include "TimerScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace core
+{
+    // Intervals are clamped, so a zero interval doesn't fire again within the same pass
+    constexpr double MinInterval = 0.001;
+
+    bool TimerScheduler::isEarlier(const Entry &a, const Entry &b)
+    {
+        return a.deadline < b.deadline || (a.deadline == b.deadline && a.key < b.key);
+    }
+
+    uint64_t TimerScheduler::add(double now, double delay, double interval, TimerCallback callback, void *data,
+                                 uint32_t timerId)
+    {
+        uint64_t key = mNextKey++;
+        interval = interval > 0 ? std::max(interval, MinInterval) : 0;
+        mHeap.push_back({now + delay, interval, key, callback, data, timerId});
+        mPositions[key] = mHeap.size() - 1;
+        siftUp(mHeap.size() - 1);
+        return key;
+    }
+
+    void TimerScheduler::cancel(uint64_t key)
+    {
+        auto position = mPositions.find(key);
+        if (position != mPositions.end())
+        {
+            removeAt(position->second);
+        }
+    }
+
+    void TimerScheduler::cancelAll(const void *data)
+    {
+        auto isOwned = [data](const Entry &entry) { return entry.data == data; };
+        if (std::erase_if(mHeap, isOwned) == 0)
+        {
+            return;
+        }
+
+        std::make_heap(mHeap.begin(), mHeap.end(), [](const Entry &a, const Entry &b) { return isEarlier(b, a); });
+        mPositions.clear();
+        for (size_t i = 0; i < mHeap.size(); i++)
+        {
+            mPositions[mHeap[i].key] = i;
+        }
+    }
+
+    double TimerScheduler::getNextDeadline() const
+    {
+        return mHeap.empty() ? std::numeric_limits<double>::infinity() : mHeap.front().deadline;
+    }
+
+    bool TimerScheduler::runNext(double now)
+    {
+        if (mHeap.empty() || mHeap.front().deadline > now)
+        {
+            return false;
+        }
+
+        // The timer is rescheduled or removed before the callback, so the callback can clear it or add new timers
+        Entry &entry = mHeap.front();
+        TimerCallback callback = entry.callback;
+        void *data = entry.data;
+        uint32_t timerId = entry.timerId;
+        bool isLastRun = entry.interval <= 0;
+
+        if (isLastRun)
+        {
+            removeAt(0);
+        }
+        else
+        {
+            // Ticks missed by a long frame are skipped, keeping the phase of the interval
+            double nextDeadline = entry.deadline + entry.interval;
+            if (nextDeadline <= now)
+            {
+                nextDeadline += (std::floor((now - nextDeadline) / entry.interval) + 1) * entry.interval;
+            }
+            entry.deadline = nextDeadline;
+            siftDown(0);
+        }
+
+        callback(data, timerId, isLastRun);
+        return true;
+    }
+
+    size_t TimerScheduler::countDue(double now) const
+    {
+        return countDueFrom(0, now);
+    }
+
+    size_t TimerScheduler::countDueFrom(size_t index, double now) const
+    {
+        // Children of a timer that is not due are not due either
+        if (index >= mHeap.size() || mHeap[index].deadline > now)
+        {
+            return 0;
+        }
+
+        return 1 + countDueFrom(index * 2 + 1, now) + countDueFrom(index * 2 + 2, now);
+    }
+
+    void TimerScheduler::clear()
+    {
+        mHeap.clear();
+        mPositions.clear();
+    }
+
+    void TimerScheduler::place(size_t index, Entry &&entry)
+    {
+        mPositions[entry.key] = index;
+        mHeap[index] = std::move(entry);
+    }
+
+    void TimerScheduler::siftUp(size_t index)
+    {
+        Entry entry = std::move(mHeap[index]);
+        while (index > 0)
+        {
+            size_t parent = (index - 1) / 2;
+            if (!isEarlier(entry, mHeap[parent]))
+            {
+                break;
+            }
+            place(index, std::move(mHeap[parent]));
+            index = parent;
+        }
+        place(index, std::move(entry));
+    }
+
+    void TimerScheduler::siftDown(size_t index)
+    {
+        Entry entry = std::move(mHeap[index]);
+        size_t size = mHeap.size();
+        while (true)
+        {
+            size_t child = index * 2 + 1;
+            if (child >= size)
+            {
+                break;
+            }
+            if (child + 1 < size && isEarlier(mHeap[child + 1], mHeap[child]))
+            {
+                child++;
+            }
+            if (!isEarlier(mHeap[child], entry))
+            {
+                break;
+            }
+            place(index, std::move(mHeap[child]));
+            index = child;
+        }
+        place(index, std::move(entry));
+    }
+
+    void TimerScheduler::removeAt(size_t index)
+    {
+        mPositions.erase(mHeap[index].key);
+
+        size_t last = mHeap.size() - 1;
+        if (index != last)
+        {
+            place(index, std::move(mHeap[last]));
+            mHeap.pop_back();
+
+            // The moved entry may belong above or below its new position
+            if (index > 0 && isEarlier(mHeap[index], mHeap[(index - 1) / 2]))
+            {
+                siftUp(index);
+            }
+            else
+            {
+                siftDown(index);
+            }
+        }
+        else
+        {
+            mHeap.pop_back();
+        }
+    }
+}  // namespace core
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace core
+{
+    // Called when the timer is due. The last run is the one after which the timer is removed.
+    using TimerCallback = void (*)(void *data, uint32_t timerId, bool isLastRun);
+
+    /// @brief Engine-owned min-heap of the JS timers, keyed by deadline. Each timer knows its heap position, so a
+    /// cleared timer is removed right away instead of waiting for its deadline, and an interval is rescheduled in
+    /// place. Intervals are fired from their scheduled deadline, so they don't drift by the time spent in the frame.
+    /// Times are monotonic seconds. Not thread-safe, timers are only set from the isolate thread.
+    class TimerScheduler
+    {
+    public:
+        /// @brief Adds a timer firing after the delay, then every interval if the interval is positive. Returns the key
+        /// to cancel it.
+        uint64_t add(double now, double delay, double interval, TimerCallback callback, void *data, uint32_t timerId);
+
+        void cancel(uint64_t key);
+
+        /// @brief Removes all the timers with the callback data, e.g. when their context is destroyed
+        void cancelAll(const void *data);
+
+        /// @brief Deadline of the earliest timer, or infinity if there are no timers
+        double getNextDeadline() const;
+
+        /// @brief Fires the earliest timer if it's due. Returns false if no timer was due.
+        bool runNext(double now);
+
+        /// @brief Number of timers that are due at the given time
+        std::size_t countDue(double now) const;
+
+        void clear();
+
+        std::size_t size() const
+        {
+            return mHeap.size();
+        }
+
+    private:
+        struct Entry
+        {
+            double deadline;
+            double interval;
+            // Keys grow with every added timer, so they order the timers with equal deadlines
+            uint64_t key;
+            TimerCallback callback;
+            void *data;
+            uint32_t timerId;
+        };
+
+        std::vector<Entry> mHeap;
+        std::unordered_map<uint64_t, std::size_t> mPositions;
+        uint64_t mNextKey = 1;
+
+        static bool isEarlier(const Entry &a, const Entry &b);
+
+        void place(std::size_t index, Entry &&entry);
+        void siftUp(std::size_t index);
+        void siftDown(std::size_t index);
+        void removeAt(std::size_t index);
+        std::size_t countDueFrom(std::size_t index, double now) const;
+    };
+}  // namespace core
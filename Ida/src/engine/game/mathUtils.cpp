@@ -0,0 +1,57 @@
+#include "mathUtils.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../core/argumentsHandler.h"
+#include "templateUtils.h"
+
+namespace Ida
+{
+    void MathUtils::distance(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        BEGIN_SCOPE
+        VALIDATE_ARGS_COUNT(4);
+        VALIDATE_VALUE(double, Number, args[0], x1, std::nullopt);
+        VALIDATE_VALUE(double, Number, args[1], y1, std::nullopt);
+        VALIDATE_VALUE(double, Number, args[2], x2, std::nullopt);
+        VALIDATE_VALUE(double, Number, args[3], y2, std::nullopt);
+
+        args.GetReturnValue().Set(std::hypot(x2 - x1, y2 - y1));
+    }
+
+    double MathUtils::fastDistance(v8::Local<v8::Object>, double x1, double y1, double x2, double y2)
+    {
+        return std::hypot(x2 - x1, y2 - y1);
+    }
+
+    double MathUtils::clamp(double value, double min, double max)
+    {
+        return std::clamp(value, min, max);
+    }
+
+    double MathUtils::lerp(double from, double to, double t)
+    {
+        return std::lerp(from, to, t);
+    }
+
+    void MathUtils::inscope_build(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> namespaceTemplate)
+    {
+        inscope_bindFastFunctions(isolate, namespaceTemplate, {FAST_FN(distance, fastDistance)});
+        // The same callback without its fast path, to compare both in the benchmark
+        inscope_bindFunctions(isolate, namespaceTemplate, {{"slowDistance", distance}});
+        inscope_bindFunctions(isolate, namespaceTemplate, {TYPED_FN(clamp), TYPED_FN(lerp)});
+    }
+
+    // Bound after the context is created, so the functions need no external references in the startup snapshot
+    void MathUtils::inscope_bind(v8::Isolate *isolate, v8::Local<v8::Object> globalObject)
+    {
+        v8::Local<v8::Context> context = isolate->GetCurrentContext();
+        v8::Local<v8::ObjectTemplate> namespaceTemplate = v8::ObjectTemplate::New(isolate);
+        inscope_build(isolate, namespaceTemplate);
+        globalObject
+            ->Set(context, v8::String::NewFromUtf8Literal(isolate, "mathUtils"),
+                  namespaceTemplate->NewInstance(context).ToLocalChecked())
+            .Check();
+    }
+}  // namespace Ida
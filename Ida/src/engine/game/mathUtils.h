@@ -0,0 +1,24 @@
+#pragma once
+
+#include <v8.h>
+
+namespace Ida
+{
+    /// @brief Geometry helpers of the mathUtils global, bound with the fast and typed paths of templateUtils.h. Not
+    /// part of the mod globals: a host opts in by calling inscope_bind from its ClientObjects::init.
+    class MathUtils
+    {
+    public:
+        static void inscope_bind(v8::Isolate *isolate, v8::Local<v8::Object> globalObject);
+
+        // Bound with TYPED_FN, which calls them from the generated callback
+        static double clamp(double value, double min, double max);
+        static double lerp(double from, double to, double t);
+
+    private:
+        static void inscope_build(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> namespaceTemplate);
+
+        static void distance(const v8::FunctionCallbackInfo<v8::Value> &args);
+        static double fastDistance(v8::Local<v8::Object> receiver, double x1, double y1, double x2, double y2);
+    };
+}  // namespace Ida
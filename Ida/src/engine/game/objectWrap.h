@@ -0,0 +1,148 @@
+#pragma once
+
+#include <v8.h>
+
+#include <initializer_list>
+#include <utility>
+
+#include "../core/argumentsHandler.h"
+#include "../core/engine.h"
+
+// This file contains the base of the host classes exposed to JS as wrapped objects
+
+namespace Ida
+{
+    enum class WrapOwnership
+    {
+        // The host deletes the object. The wrapper is released with it, and later calls from JS throw.
+        Host,
+        // The object is deleted when its wrapper is garbage collected
+        Script
+    };
+
+    /// @brief Base of a host class T exposed to JS. The JS class is defined once per isolate and its template is cached
+    /// by the engine. Wrappers hold the T pointer in the internal field 0, so the methods get their instance with a
+    /// pointer load (see TYPED_METHOD). Methods are bound on the prototype with a receiver check, so they can't be
+    /// called on other objects.
+    template <typename T>
+    class ObjectWrap
+    {
+    public:
+        ObjectWrap() = default;
+        ObjectWrap(const ObjectWrap &) = delete;
+        ObjectWrap &operator=(const ObjectWrap &) = delete;
+
+        /// @brief Releases the wrapper, so the calls made from JS afterwards throw instead of using a deleted object.
+        /// Host-owned objects must be deleted on the thread using the isolate.
+        virtual ~ObjectWrap()
+        {
+            if (mWrapper.IsEmpty())
+            {
+                return;
+            }
+
+            v8::Isolate::Scope isolateScope(mIsolate);
+            v8::HandleScope handleScope(mIsolate);
+            mWrapper.Get(mIsolate)->SetAlignedPointerInInternalField(0, nullptr);
+            mWrapper.Reset();
+        }
+
+        /// @brief Creates the JS class of T in the isolate, replacing the previous definition
+        static v8::Local<v8::FunctionTemplate> inscope_defineClass(
+            v8::Isolate *isolate, const char *className,
+            std::initializer_list<std::pair<const char *, v8::FunctionCallback>> methods)
+        {
+            v8::Local<v8::FunctionTemplate> classTemplate = v8::FunctionTemplate::New(isolate, illegalConstructor);
+            classTemplate->SetClassName(v8::String::NewFromUtf8(isolate, className).ToLocalChecked());
+            classTemplate->InstanceTemplate()->SetInternalFieldCount(1);
+
+            v8::Local<v8::Signature> signature = v8::Signature::New(isolate, classTemplate);
+            v8::Local<v8::ObjectTemplate> prototype = classTemplate->PrototypeTemplate();
+            for (auto &method : methods)
+            {
+                prototype->Set(v8::String::NewFromUtf8(isolate, method.first).ToLocalChecked(),
+                               v8::FunctionTemplate::New(isolate, method.second, v8::Local<v8::Value>(), signature));
+            }
+
+            core::Engine::fromIsolate(isolate)->inscope_setClassTemplate(&ClassKey, classTemplate);
+            return classTemplate;
+        }
+
+        /// @brief Template defined by inscope_defineClass, empty if the class is not defined in the isolate
+        static v8::Local<v8::FunctionTemplate> inscope_getClassTemplate(v8::Isolate *isolate)
+        {
+            return core::Engine::fromIsolate(isolate)->inscope_getClassTemplate(&ClassKey);
+        }
+
+        /// @brief Returns the object wrapped by the value, or nullptr if it's not a wrapper of T or was released
+        static T *inscope_unwrap(v8::Isolate *isolate, v8::Local<v8::Value> value)
+        {
+            v8::Local<v8::FunctionTemplate> classTemplate = inscope_getClassTemplate(isolate);
+            if (classTemplate.IsEmpty() || !classTemplate->HasInstance(value))
+            {
+                return nullptr;
+            }
+
+            return static_cast<T *>(value.As<v8::Object>()->GetAlignedPointerFromInternalField(0));
+        }
+
+        /// @brief Returns the JS object of this instance, creating it on the first call. The ownership is set by the
+        /// first call. The wrapper of a host-owned object may be collected while unused, so JS properties set on it
+        /// are not kept.
+        v8::Local<v8::Object> inscope_getWrapper(v8::Isolate *isolate, WrapOwnership ownership = WrapOwnership::Host)
+        {
+            if (!mWrapper.IsEmpty())
+            {
+                return mWrapper.Get(isolate);
+            }
+
+            v8::Local<v8::FunctionTemplate> classTemplate = inscope_getClassTemplate(isolate);
+            if (classTemplate.IsEmpty())
+            {
+                return v8::Local<v8::Object>();
+            }
+
+            v8::Local<v8::Object> wrapper =
+                classTemplate->InstanceTemplate()->NewInstance(isolate->GetCurrentContext()).ToLocalChecked();
+            wrapper->SetAlignedPointerInInternalField(0, static_cast<T *>(this));
+
+            mIsolate = isolate;
+            mOwnership = ownership;
+            mWrapper.Reset(isolate, wrapper);
+            mWrapper.SetWeak(this, onWrapperCollected, v8::WeakCallbackType::kParameter);
+            return wrapper;
+        }
+
+    private:
+        // Its address identifies the class in the template cache of the engine
+        static inline const char ClassKey = 0;
+
+        v8::Isolate *mIsolate = nullptr;
+        v8::Global<v8::Object> mWrapper;
+        WrapOwnership mOwnership = WrapOwnership::Host;
+
+        static void illegalConstructor(const v8::FunctionCallbackInfo<v8::Value> &args)
+        {
+            core::inscope_ThrowTypeError(args.GetIsolate(), "Illegal constructor");
+        }
+
+        static void onWrapperCollected(const v8::WeakCallbackInfo<ObjectWrap> &info)
+        {
+            ObjectWrap *objectWrap = info.GetParameter();
+            objectWrap->mWrapper.Reset();
+            if (objectWrap->mOwnership == WrapOwnership::Script)
+            {
+                delete objectWrap;
+            }
+        }
+    };
+}  // namespace Ida
+
+/// @brief Macro to get the wrapped object of the receiver, needs BEGIN_SCOPE
+#define UNWRAP_THIS(Class, name)                                                \
+    auto *name = Ida::ObjectWrap<Class>::inscope_unwrap(isolate, args.This()); \
+    if (!name)                                                                 \
+    {                                                                          \
+        core::inscope_ThrowTypeError(isolate, "Illegal invocation");           \
+        return;                                                                \
+    }
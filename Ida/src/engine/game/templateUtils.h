@@ -1,7 +1,12 @@
 #pragma once
 
+#include <v8-fast-api-calls.h>
 #include <v8.h>
 
+#include <type_traits>
+
+#include "typedFunction.h"
+
 // This file contains utility functions to setup the JS objects templates
 
 namespace Ida
@@ -18,6 +23,52 @@ namespace Ida
         tmpl->Set(v8::String::NewFromUtf8(isolate, "Events").ToLocalChecked(), eventsTpl);
     }
 
+    template <const auto &Events>
+    void lazyEventsGetter(v8::Local<v8::Name>, const v8::PropertyCallbackInfo<v8::Value> &info)
+    {
+        v8::Isolate *isolate = info.GetIsolate();
+        v8::Local<v8::Context> context = isolate->GetCurrentContext();
+        v8::Local<v8::Object> events = v8::Object::New(isolate);
+        for (const char *event : Events)
+        {
+            v8::Local<v8::String> eventName =
+                v8::String::NewFromUtf8(isolate, event, v8::NewStringType::kInternalized).ToLocalChecked();
+            events->Set(context, eventName, eventName).Check();
+        }
+        info.GetReturnValue().Set(events);
+    }
+
+    /// @brief Like inscope_declareEvents, but the Events object is only created when a script first reads it. The
+    /// events are a static array, e.g. static constexpr const char *UnitEvents[] = {"spawn", "death"}.
+    template <const auto &Events>
+    void inscope_declareLazyEvents(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> tmpl)
+    {
+        tmpl->SetLazyDataProperty(v8::String::NewFromUtf8Literal(isolate, "Events"), lazyEventsGetter<Events>);
+    }
+
+    // Fills the template of a namespace object, e.g. by inscope_bindFunctions
+    using NamespaceBuilder = void (*)(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> namespaceTemplate);
+
+    template <NamespaceBuilder Builder>
+    void lazyNamespaceGetter(v8::Local<v8::Name>, const v8::PropertyCallbackInfo<v8::Value> &info)
+    {
+        v8::Isolate *isolate = info.GetIsolate();
+        v8::Local<v8::ObjectTemplate> namespaceTemplate = v8::ObjectTemplate::New(isolate);
+        Builder(isolate, namespaceTemplate);
+        info.GetReturnValue().Set(namespaceTemplate->NewInstance(isolate->GetCurrentContext()).ToLocalChecked());
+    }
+
+    /// @brief Declares a namespace object that is built on the first access in each context, so contexts only pay for
+    /// the parts of a large API their scripts use. V8 replaces the lazy property with the built object, so later
+    /// accesses are regular property loads.
+    template <NamespaceBuilder Builder>
+    void inscope_declareLazyNamespace(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> tmpl, const char *name)
+    {
+        tmpl->SetLazyDataProperty(v8::String::NewFromUtf8(isolate, name, v8::NewStringType::kInternalized)
+                                      .ToLocalChecked(),
+                                  lazyNamespaceGetter<Builder>);
+    }
+
     inline void inscope_bindFunctions(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> tmpl,
                                       std::initializer_list<std::pair<const char *, v8::FunctionCallback>> funcs)
     {
@@ -27,6 +78,39 @@ namespace Ida
                       v8::FunctionTemplate::New(isolate, f.second));
         }
     }
+
+    struct FastFunctionBinding
+    {
+        const char *name;
+        v8::FunctionCallback slowCallback;
+        v8::CFunction fastCallback;
+    };
+
+    /// @brief Makes the CFunction of FAST_FN. V8 passes the receiver as the first argument of a fast function, checked
+    /// here so a wrong signature fails with this message instead of deep in the templates of v8-fast-api-calls.h.
+    template <typename Return, typename Receiver, typename... Args>
+    v8::CFunction makeFastFunction(Return (*fastFn)(Receiver, Args...))
+    {
+        static_assert(std::is_same_v<Receiver, v8::Local<v8::Object>> || std::is_same_v<Receiver, v8::Local<v8::Value>>,
+                      "The first argument of a fast function must be its v8::Local<v8::Object> receiver");
+        return v8::CFunction::Make(fastFn);
+    }
+
+    /// @brief Binds functions with a V8 Fast API path, called directly from the optimized JS code. The fast function
+    /// takes the receiver and primitive or typed array arguments, e.g. int32_t getHealth(v8::Local<v8::Object>,
+    /// int32_t id). It must not allocate JS objects, call JS or throw. The slow callback is used by the interpreter and
+    /// by the calls the fast path can't take, so both must behave the same.
+    inline void inscope_bindFastFunctions(v8::Isolate *isolate, v8::Local<v8::ObjectTemplate> tmpl,
+                                          std::initializer_list<FastFunctionBinding> funcs)
+    {
+        for (auto &f : funcs)
+        {
+            tmpl->Set(v8::String::NewFromUtf8(isolate, f.name).ToLocalChecked(),
+                      v8::FunctionTemplate::New(isolate, f.slowCallback, v8::Local<v8::Value>(),
+                                                v8::Local<v8::Signature>(), 0, v8::ConstructorBehavior::kThrow,
+                                                v8::SideEffectType::kHasSideEffect, &f.fastCallback));
+        }
+    }
 }  // namespace Ida
 
 // *****  Macros for the templates *****
@@ -34,8 +118,11 @@ namespace Ida
 /// @brief Macro to bind a function to the template
 #define FN(fn) {#fn, fn}
 
+/// @brief Macro to bind a function with its fast path to the template
+#define FAST_FN(fn, fastFn) {#fn, fn, Ida::makeFastFunction(fastFn)}
+
 #define BEGIN_SCOPE                           \
     v8::Isolate *isolate = args.GetIsolate(); \
     v8::HandleScope handleScope(isolate);
 
-// #define BIND_BRIDGE auto *idaBridge = static_cast<IdaBridge *>(args.This()->GetAlignedPointerFromInternalField(0));
+// Host classes are wrapped with Ida::ObjectWrap, see objectWrap.h
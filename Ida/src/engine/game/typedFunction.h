@@ -0,0 +1,341 @@
+#pragma once
+
+#include <v8.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "../core/argumentsHandler.h"
+#include "objectWrap.h"
+
+// This file generates the FunctionCallback of a plain C++ function at compile time, see TYPED_FN
+
+namespace Ida
+{
+    // Conversion of a JS argument to a C++ parameter. The holder lives on the stack of the callback for the duration of
+    // the call, so the converted values don't need the heap.
+    template <typename T>
+    struct ArgumentTraits;
+
+    template <>
+    struct ArgumentTraits<bool>
+    {
+        using Holder = bool;
+        static constexpr const char *typeName = "a boolean";
+
+        static bool inscope_convert(v8::Isolate *isolate, v8::Local<v8::Value> value, Holder &holder)
+        {
+            if (!value->IsBoolean())
+            {
+                return false;
+            }
+            holder = value->BooleanValue(isolate);
+            return true;
+        }
+    };
+
+    template <>
+    struct ArgumentTraits<int32_t>
+    {
+        using Holder = int32_t;
+        static constexpr const char *typeName = "an integer";
+
+        static bool inscope_convert(v8::Isolate *, v8::Local<v8::Value> value, Holder &holder)
+        {
+            if (!value->IsInt32())
+            {
+                return false;
+            }
+            holder = value.As<v8::Int32>()->Value();
+            return true;
+        }
+    };
+
+    template <>
+    struct ArgumentTraits<uint32_t>
+    {
+        using Holder = uint32_t;
+        static constexpr const char *typeName = "a non-negative integer";
+
+        static bool inscope_convert(v8::Isolate *, v8::Local<v8::Value> value, Holder &holder)
+        {
+            if (!value->IsUint32())
+            {
+                return false;
+            }
+            holder = value.As<v8::Uint32>()->Value();
+            return true;
+        }
+    };
+
+    template <>
+    struct ArgumentTraits<double>
+    {
+        using Holder = double;
+        static constexpr const char *typeName = "a number";
+
+        static bool inscope_convert(v8::Isolate *, v8::Local<v8::Value> value, Holder &holder)
+        {
+            if (!value->IsNumber())
+            {
+                return false;
+            }
+            holder = value.As<v8::Number>()->Value();
+            return true;
+        }
+    };
+
+    template <>
+    struct ArgumentTraits<float>
+    {
+        using Holder = float;
+        static constexpr const char *typeName = "a number";
+
+        static bool inscope_convert(v8::Isolate *, v8::Local<v8::Value> value, Holder &holder)
+        {
+            if (!value->IsNumber())
+            {
+                return false;
+            }
+            holder = static_cast<float>(value.As<v8::Number>()->Value());
+            return true;
+        }
+    };
+
+    // UTF-8 copy of a JS string. Strings up to the inline capacity don't touch the heap.
+    struct Utf8Holder
+    {
+        static constexpr int InlineCapacity = 256;
+
+        char inlineBuffer[InlineCapacity];
+        std::unique_ptr<char[]> heapBuffer;
+        std::string_view view;
+
+        operator std::string_view() const
+        {
+            return view;
+        }
+
+        operator std::string() const
+        {
+            return std::string(view);
+        }
+    };
+
+    template <>
+    struct ArgumentTraits<std::string_view>
+    {
+        using Holder = Utf8Holder;
+        static constexpr const char *typeName = "a string";
+
+        static bool inscope_convert(v8::Isolate *isolate, v8::Local<v8::Value> value, Holder &holder)
+        {
+            if (!value->IsString())
+            {
+                return false;
+            }
+
+            v8::Local<v8::String> string = value.As<v8::String>();
+            int length = string->Utf8Length(isolate);
+            char *buffer = holder.inlineBuffer;
+            if (length > Utf8Holder::InlineCapacity)
+            {
+                holder.heapBuffer = std::make_unique<char[]>(length);
+                buffer = holder.heapBuffer.get();
+            }
+
+            string->WriteUtf8(isolate, buffer, length, nullptr,
+                              v8::String::NO_NULL_TERMINATION | v8::String::REPLACE_INVALID_UTF8);
+            holder.view = std::string_view(buffer, length);
+            return true;
+        }
+    };
+
+    template <>
+    struct ArgumentTraits<std::string> : ArgumentTraits<std::string_view>
+    {
+    };
+
+    template <>
+    struct ArgumentTraits<v8::Local<v8::Value>>
+    {
+        using Holder = v8::Local<v8::Value>;
+        static constexpr const char *typeName = "a value";
+
+        static bool inscope_convert(v8::Isolate *, v8::Local<v8::Value> value, Holder &holder)
+        {
+            holder = value;
+            return true;
+        }
+    };
+
+    template <typename R>
+    void inscope_setReturnValue(v8::Isolate *isolate, v8::ReturnValue<v8::Value> returnValue, const R &value)
+    {
+        if constexpr (std::is_same_v<R, bool>)
+        {
+            returnValue.Set(value);
+        }
+        else if constexpr (std::is_integral_v<R> && std::is_signed_v<R> && sizeof(R) <= sizeof(int32_t))
+        {
+            returnValue.Set(static_cast<int32_t>(value));
+        }
+        else if constexpr (std::is_integral_v<R> && std::is_unsigned_v<R> && sizeof(R) <= sizeof(uint32_t))
+        {
+            returnValue.Set(static_cast<uint32_t>(value));
+        }
+        else if constexpr (std::is_arithmetic_v<R>)
+        {
+            returnValue.Set(static_cast<double>(value));
+        }
+        else if constexpr (std::is_convertible_v<const R &, std::string_view>)
+        {
+            std::string_view view = value;
+            returnValue.Set(v8::String::NewFromUtf8(isolate, view.data(), v8::NewStringType::kNormal,
+                                                    static_cast<int>(view.size()))
+                                .ToLocalChecked());
+        }
+        else
+        {
+            returnValue.Set(value);
+        }
+    }
+
+    template <typename R, typename... Args>
+    struct TypedInvoker
+    {
+        using Holders = std::tuple<typename ArgumentTraits<std::decay_t<Args>>::Holder...>;
+
+        // Converts the arguments and calls the function with them, throwing a TypeError on the first invalid one
+        template <typename Call>
+        static void inscope_invoke(const v8::FunctionCallbackInfo<v8::Value> &args, Call &&call)
+        {
+            v8::Isolate *isolate = args.GetIsolate();
+            if (!core::inscope_validateArgumentsCount(isolate, args.Length(), sizeof...(Args)))
+            {
+                return;
+            }
+
+            Holders holders;
+            if (!inscope_convertAll(isolate, args, holders, std::index_sequence_for<Args...>{}))
+            {
+                return;
+            }
+
+            if constexpr (std::is_void_v<R>)
+            {
+                std::apply([&](auto &...values) { call(values...); }, holders);
+            }
+            else
+            {
+                R result = std::apply([&](auto &...values) { return call(values...); }, holders);
+                inscope_setReturnValue<std::decay_t<R>>(isolate, args.GetReturnValue(), result);
+            }
+        }
+
+    private:
+        template <size_t... Indices>
+        // The parameters are unused by the functions without arguments
+        static bool inscope_convertAll([[maybe_unused]] v8::Isolate *isolate,
+                                       [[maybe_unused]] const v8::FunctionCallbackInfo<v8::Value> &args,
+                                       [[maybe_unused]] Holders &holders, std::index_sequence<Indices...>)
+        {
+            return (inscope_convertArgument<std::decay_t<Args>>(isolate, args[Indices], Indices,
+                                                                 std::get<Indices>(holders)) &&
+                    ...);
+        }
+
+        template <typename T>
+        static bool inscope_convertArgument(v8::Isolate *isolate, v8::Local<v8::Value> value, size_t index,
+                                            typename ArgumentTraits<T>::Holder &holder)
+        {
+            if (!ArgumentTraits<T>::inscope_convert(isolate, value, holder))
+            {
+                core::inscope_ThrowTypeError(isolate, "Argument " + std::to_string(index + 1) + " must be " +
+                                                          ArgumentTraits<T>::typeName);
+                return false;
+            }
+            return true;
+        }
+    };
+
+    // Instance of a member function call. The receiver must be a wrapper of the class, as a method can be called on
+    // any object with Function.prototype.call.
+    template <typename Class>
+    Class *inscope_unwrapReceiver(const v8::FunctionCallbackInfo<v8::Value> &args)
+    {
+        static_assert(std::is_base_of_v<ObjectWrap<Class>, Class>,
+                      "TYPED_METHOD needs a class derived from ObjectWrap");
+
+        v8::Isolate *isolate = args.GetIsolate();
+        v8::Local<v8::FunctionTemplate> classTemplate = ObjectWrap<Class>::inscope_getClassTemplate(isolate);
+        if (classTemplate.IsEmpty() || !classTemplate->HasInstance(args.This()))
+        {
+            core::inscope_ThrowTypeError(isolate, "Illegal invocation");
+            return nullptr;
+        }
+
+        auto *instance = static_cast<Class *>(args.This()->GetAlignedPointerFromInternalField(0));
+        if (!instance)
+        {
+            core::inscope_ThrowTypeError(isolate, "The native object was released");
+        }
+        return instance;
+    }
+
+    /// @brief FunctionCallback generated from the signature of a free function or a member function. For member
+    /// functions the instance is the ObjectWrap of the receiver.
+    template <auto Function>
+    struct TypedFunction;
+
+    template <typename R, typename... Args, R (*Function)(Args...)>
+    struct TypedFunction<Function>
+    {
+        static void callback(const v8::FunctionCallbackInfo<v8::Value> &args)
+        {
+            TypedInvoker<R, Args...>::inscope_invoke(args, [](auto &...values) { return Function(values...); });
+        }
+    };
+
+    template <typename Class, typename R, typename... Args, R (Class::*Function)(Args...)>
+    struct TypedFunction<Function>
+    {
+        static void callback(const v8::FunctionCallbackInfo<v8::Value> &args)
+        {
+            Class *instance = inscope_unwrapReceiver<Class>(args);
+            if (!instance)
+            {
+                return;
+            }
+            TypedInvoker<R, Args...>::inscope_invoke(
+                args, [instance](auto &...values) { return (instance->*Function)(values...); });
+        }
+    };
+
+    template <typename Class, typename R, typename... Args, R (Class::*Function)(Args...) const>
+    struct TypedFunction<Function>
+    {
+        static void callback(const v8::FunctionCallbackInfo<v8::Value> &args)
+        {
+            const Class *instance = inscope_unwrapReceiver<Class>(args);
+            if (!instance)
+            {
+                return;
+            }
+            TypedInvoker<R, Args...>::inscope_invoke(
+                args, [instance](auto &...values) { return (instance->*Function)(values...); });
+        }
+    };
+}  // namespace Ida
+
+/// @brief Macro to bind a plain C++ function to the template, with the arguments validated and converted by its
+/// signature
+#define TYPED_FN(fn) {#fn, Ida::TypedFunction<&fn>::callback}
+
+/// @brief Macro to bind a member function of an ObjectWrap class, e.g. in inscope_defineClass. Calls on other receivers
+/// throw a TypeError.
+#define TYPED_METHOD(Class, method) {#method, Ida::TypedFunction<&Class::method>::callback}
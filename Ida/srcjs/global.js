@@ -2,12 +2,33 @@ this.window = this;
 this.globalThis = this;
 window.global = window;
 
-globalThis._logLevel = 0;
-console.debug = (...args) => _logLevel === 0 && logger.debug(...args);
-console.log = (...args) => _logLevel <= 1 && logger.log(...args);
-console.info = (...args) => _logLevel <= 1 && logger.info(...args);
-console.warn = (...args) => _logLevel <= 2 && logger.warn(...args);
-console.error = (...args) => _logLevel <= 3 && logger.error(...args);
+// Log level of the scripts, from 0 (debug) to 4 (none). The engine binds the console methods to the logger ones, and
+// the methods of the disabled levels to a no-op.
+Object.defineProperty(globalThis, "_logLevel", {
+  get: () => logger.level,
+  set: (level) => {
+    logger.level = level;
+  },
+});
+
+// Delivers a batch of host events, each one as [eventName, ...args]. An exception in one handler doesn't stop the rest,
+// it is logged by the host as an uncaught one. While the host records the latencies, endTimes receives the end of each
+// event, negated when its handler threw, which counts the exception.
+globalThis._handleEvents = function (events, endTimes) {
+  for (let i = 0; i < events.length; i++) {
+    let threw = false;
+    try {
+      this._handleEvent.apply(this, events[i]);
+    } catch (e) {
+      threw = true;
+      _reportException(e);
+    }
+    if (endTimes) {
+      const now = _latencyNow();
+      endTimes[i] = threw ? -now : now;
+    }
+  }
+};
 
 // Can add your system js files and modules here
 // require("./system.js");
@@ -89,6 +89,19 @@ test.group("Core Tests", () => {
     }, 300);
   });
 
+  test("clearInterval inside the interval callback stops it", () => {
+    let counter = 0;
+    const intervalId = setInterval(() => {
+      counter++;
+      if (counter === 2) {
+        clearInterval(intervalId);
+      }
+    }, 20);
+    setTimeout(() => {
+      expect.equal(counter, 2);
+    }, 200);
+  });
+
   test("setTimeout runs function with default delay 0", () => {
     let success = false;
     setTimeout(() => {
@@ -260,6 +273,188 @@ test.group("Core Tests", () => {
     }, 50);
   });
 
+  test("_handleEvents delivers all events even if a handler throws", () => {
+    const received = [];
+    const target = {
+      _handleEvent(name, value) {
+        if (name === "fail") {
+          throw new Error("This error means everything is fine");
+        }
+        received.push(name + value);
+      },
+    };
+    // @ts-ignore
+    _handleEvents.call(target, [["a", 1], ["fail"], ["b", 2]]);
+    expect.collectionEqual(received, ["a1", "b2"]);
+  });
+
+  test("_reportException logs any thrown value without throwing", () => {
+    // @ts-ignore
+    _reportException(new Error("This error means everything is fine"));
+    // @ts-ignore
+    _reportException("This string means everything is fine");
+  });
+
+  test("_handleEvents writes the end time of each event for the latency recorder", () => {
+    const target = {
+      _handleEvent(name) {
+        if (name === "fail") {
+          throw new Error("This error means everything is fine");
+        }
+      },
+    };
+    const endTimes = new Float64Array(3);
+    // @ts-ignore
+    _handleEvents.call(target, [["a"], ["fail"], ["b"]], endTimes);
+    expect.true(endTimes[0] > 0);
+    expect.true(endTimes[1] < 0);
+    expect.gte(-endTimes[1], endTimes[2]);
+    expect.gte(endTimes[0], -endTimes[1]);
+  });
+
+  test("performance.measure measures between marks", () => {
+    performance.mark("test-start");
+    let sum = 0;
+    for (let i = 0; i < 1000; i++) {
+      sum += i;
+    }
+    performance.mark("test-end");
+    const duration = performance.measure("test-loop", "test-start", "test-end");
+    expect.gte(0, duration);
+
+    const entry = performance.getEntries().findLast((e) => e.name === "test-loop");
+    expect.eq(entry.entryType, "measure");
+    expect.eq(entry.duration, duration);
+  });
+
+  test("performance.measure throws when the mark does not exist", () => {
+    try {
+      performance.measure("test-missing", "non-existing-mark");
+      expect.true(false);
+    } catch (e) {
+      expect.true(e instanceof Error && e.message.includes("non-existing-mark"));
+    }
+  });
+
+  test("profiler records one profile at a time", () => {
+    // The same file is overwritten by every run
+    expect.true(profiler.start(500));
+    expect.false(profiler.start());
+    try {
+      profiler.stop("tests/test.cpuprofile", "svg");
+      expect.true(false);
+    } catch (e) {
+      expect.true(e instanceof RangeError);
+    }
+    expect.true(profiler.stop("tests/test.cpuprofile"));
+    expect.false(profiler.stop("tests/test.cpuprofile"));
+  });
+
+  test("profiler only writes in the diagnostics directory", () => {
+    for (const path of ["../test.cpuprofile", "tests/../../test.cpuprofile", "/tmp/test.cpuprofile"]) {
+      expect.true(profiler.start());
+      try {
+        profiler.stop(path);
+        expect.true(false);
+      } catch (e) {
+        expect.true(e instanceof RangeError);
+      }
+      // The profile is still recording after the rejected path
+      expect.true(profiler.stop("tests/test.cpuprofile"));
+
+      try {
+        profiler.writeHeapSnapshot(path.replace(".cpuprofile", ".heapsnapshot"));
+        expect.true(false);
+      } catch (e) {
+        expect.true(e instanceof RangeError);
+      }
+    }
+  });
+
+  test("profiler.getHeapStats reports the heap and its spaces", () => {
+    const stats = profiler.getHeapStats();
+    expect.gt(0, stats.usedHeapSize);
+    expect.gte(stats.usedHeapSize, stats.totalHeapSize);
+    expect.gt(0, stats.spaces.length);
+    expect.true(stats.spaces.some((space) => space.name === "old_space"));
+  });
+
+  test("console methods of the disabled log levels are no-ops", () => {
+    const previousLevel = _logLevel;
+    _logLevel = 2;
+    expect.eq(logger.level, 2);
+    expect.eq(console.debug, console.log);
+    expect.eq(console.warn, logger.warn);
+    _logLevel = previousLevel;
+    expect.eq(logger.level, previousLevel);
+  });
+
+  test("logger.level binds the console again for every level", () => {
+    const previousLevel = logger.level;
+    logger.level = 0;
+    expect.eq(console.debug, logger.debug);
+    expect.eq(console.error, logger.error);
+    logger.level = 4;
+    expect.eq(console.error, console.debug);
+    expect.true(console.error !== logger.error);
+    logger.level = previousLevel;
+    expect.eq(logger.level, previousLevel);
+  });
+
+  // mathUtils is not a mod global, the host running the tests binds it with Ida::MathUtils::inscope_bind
+  test("mathUtils.distance gives the same result through the slow and fast paths", () => {
+    // The first calls run in the interpreter, which takes the slow callback
+    expect.eq(mathUtils.distance(0, 0, 3, 4), 5);
+    expect.eq(mathUtils.slowDistance(0, 0, 3, 4), 5);
+
+    // slowDistance binds the same callback without the fast path. Each loop calls its method directly, so the call
+    // sites stay monomorphic and keep their receiver, as the fast path needs.
+    const iterations = 200000;
+    let slowSum = 0;
+    let start = performance.now();
+    for (let i = 0; i < iterations; i++) {
+      slowSum += mathUtils.slowDistance(0, 0, 3, 4);
+    }
+    const slow = (((performance.now() - start) * 1e6) / iterations).toFixed(1);
+
+    let fastSum = 0;
+    start = performance.now();
+    for (let i = 0; i < iterations; i++) {
+      fastSum += mathUtils.distance(0, 0, 3, 4);
+    }
+    const fast = (((performance.now() - start) * 1e6) / iterations).toFixed(1);
+
+    expect.eq(slowSum, 5 * iterations);
+    expect.eq(fastSum, 5 * iterations);
+    console.log(`mathUtils.distance: ${slow} ns per call with FN, ${fast} ns per call with FAST_FN`);
+
+    try {
+      mathUtils.distance(0, 0, "3", 4);
+      expect.true(false);
+    } catch (e) {
+      expect.true(e instanceof TypeError);
+    }
+  });
+
+  test("typed functions validate and convert their arguments", () => {
+    expect.eq(mathUtils.clamp(5, 0, 3), 3);
+    expect.eq(mathUtils.lerp(10, 20, 0.25), 12.5);
+
+    try {
+      mathUtils.clamp(5, 0);
+      expect.true(false);
+    } catch (e) {
+      expect.true(e instanceof Error && e.message === "Expected at least 3 arguments");
+    }
+
+    try {
+      mathUtils.clamp(5, "0", 3);
+      expect.true(false);
+    } catch (e) {
+      expect.true(e instanceof TypeError && e.message === "Argument 2 must be a number");
+    }
+  });
+
   test("ICU works", () => {
     const formatter = new Intl.DateTimeFormat("fr", { dateStyle: "long" });
     const formattedDate = formatter.format(new Date(2025, 0, 27));
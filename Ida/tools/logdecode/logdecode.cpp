@@ -0,0 +1,284 @@
+// Renders a binary log written by Logger::startBinaryLog as the text the sinks would have written, with the time of
+// each line. Usage: logdecode <log file> [--sites]
+// With --sites, each line ends with the file, the line and the function of its call site.
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "../../src/common/BinaryLogFormat.h"
+
+using namespace Logger::BinaryLogFormat;
+
+struct CallSite
+{
+    std::string file;
+    uint32_t line = 0;
+    std::string function;
+};
+
+static constexpr const char *LevelPrefixes[] = {"[dbg] ", "[inf] ", "[wrn] ", "[err] "};
+
+static void writeTimestamp(std::string &out, uint64_t micros)
+{
+    std::time_t seconds = static_cast<std::time_t>(micros / 1000000);
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", std::localtime(&seconds));
+    out += text;
+
+    char fraction[8];
+    std::snprintf(fraction, sizeof(fraction), ".%06u", static_cast<unsigned>(micros % 1000000));
+    out += fraction;
+    out += ' ';
+}
+
+// As JavaScript converts the numbers to strings
+static void writeJsNumber(std::string &out, double value)
+{
+    if (std::isnan(value))
+    {
+        out += "NaN";
+    }
+    else if (std::isinf(value))
+    {
+        out += value > 0 ? "Infinity" : "-Infinity";
+    }
+    else if (value == 0)
+    {
+        out += '0';
+    }
+    else
+    {
+        char text[32];
+        auto result = std::to_chars(text, text + sizeof(text), value);
+        out.append(text, result.ptr);
+    }
+}
+
+// The JS lines are the arguments separated by spaces, the host lines are the arguments as they were streamed
+static bool writeArguments(std::string &out, const char *cursor, const char *end, bool isJs)
+{
+    std::ostringstream formatter;
+    bool isFirst = true;
+    while (cursor < end)
+    {
+        if (isJs && !isFirst)
+        {
+            out += ' ';
+        }
+        isFirst = false;
+
+        ArgumentType type;
+        if (!read(cursor, end, type))
+        {
+            return false;
+        }
+
+        switch (type)
+        {
+            case ArgumentType::Int:
+            {
+                int64_t value;
+                if (!read(cursor, end, value))
+                {
+                    return false;
+                }
+                out += std::to_string(value);
+                break;
+            }
+            case ArgumentType::UInt:
+            {
+                uint64_t value;
+                if (!read(cursor, end, value))
+                {
+                    return false;
+                }
+                out += std::to_string(value);
+                break;
+            }
+            case ArgumentType::Double:
+            {
+                double value;
+                if (!read(cursor, end, value))
+                {
+                    return false;
+                }
+                if (isJs)
+                {
+                    writeJsNumber(out, value);
+                }
+                else
+                {
+                    formatter.str("");
+                    formatter << value;
+                    out += formatter.str();
+                }
+                break;
+            }
+            case ArgumentType::Bool:
+            {
+                uint8_t value;
+                if (!read(cursor, end, value))
+                {
+                    return false;
+                }
+                out += isJs ? (value ? "true" : "false") : (value ? "1" : "0");
+                break;
+            }
+            case ArgumentType::Char:
+            {
+                char value;
+                if (!read(cursor, end, value))
+                {
+                    return false;
+                }
+                out += value;
+                break;
+            }
+            case ArgumentType::String:
+            {
+                std::string_view value;
+                if (!readString(cursor, end, value))
+                {
+                    return false;
+                }
+                out += value;
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: logdecode <log file> [--sites]" << std::endl;
+        return 1;
+    }
+
+    bool isPrintingSites = argc > 2 && std::string_view(argv[2]) == "--sites";
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    const char *cursor = data.data();
+    const char *end = data.data() + data.size();
+    uint16_t version = 0;
+    if (data.size() < FileHeaderSize || data.compare(0, sizeof(Magic), Magic, sizeof(Magic)) != 0)
+    {
+        std::cerr << argv[1] << " is not a binary log" << std::endl;
+        return 1;
+    }
+    cursor += sizeof(Magic);
+    read(cursor, end, version);
+    if (version != Version)
+    {
+        std::cerr << "Unsupported binary log version " << version << std::endl;
+        return 1;
+    }
+
+    std::unordered_map<uint32_t, CallSite> callSites;
+    std::unordered_map<uint32_t, std::string> modules;
+    std::string line;
+    while (cursor < end)
+    {
+        RecordType type;
+        uint32_t size;
+        if (!read(cursor, end, type) || !read(cursor, end, size) || static_cast<size_t>(end - cursor) < size)
+        {
+            // The process was killed while writing the record
+            std::cerr << "The log ends with a truncated record" << std::endl;
+            return 2;
+        }
+
+        const char *recordEnd = cursor + size;
+        const char *payload = cursor;
+        cursor = recordEnd;
+
+        if (type == RecordType::CallSite)
+        {
+            uint32_t id;
+            CallSite site;
+            std::string_view fileName;
+            std::string_view function;
+            if (read(payload, recordEnd, id) && read(payload, recordEnd, site.line) &&
+                readString(payload, recordEnd, fileName) && readString(payload, recordEnd, function))
+            {
+                site.file = fileName;
+                site.function = function;
+                callSites[id] = std::move(site);
+            }
+        }
+        else if (type == RecordType::Module)
+        {
+            uint32_t id;
+            std::string_view name;
+            if (read(payload, recordEnd, id) && readString(payload, recordEnd, name))
+            {
+                modules[id] = name;
+            }
+        }
+        else if (type == RecordType::Message)
+        {
+            uint32_t callSiteId;
+            uint64_t timestamp;
+            uint8_t level;
+            uint32_t moduleId;
+            if (!read(payload, recordEnd, callSiteId) || !read(payload, recordEnd, timestamp) ||
+                !read(payload, recordEnd, level) || !read(payload, recordEnd, moduleId))
+            {
+                continue;
+            }
+
+            line.clear();
+            writeTimestamp(line, timestamp);
+            if (moduleId != 0)
+            {
+                auto module = modules.find(moduleId);
+                line += '[';
+                line += module != modules.end() ? module->second : "unknown";
+                line += "] ";
+            }
+            line += level < std::size(LevelPrefixes) ? LevelPrefixes[level] : "[???] ";
+
+            if (!writeArguments(line, payload, recordEnd, moduleId != 0))
+            {
+                line += "<malformed arguments>";
+            }
+
+            if (isPrintingSites)
+            {
+                auto site = callSites.find(callSiteId);
+                if (site != callSites.end())
+                {
+                    const CallSite &callSite = site->second;
+                    line += "  (" + callSite.file + ":" + std::to_string(callSite.line) + " " + callSite.function + ")";
+                }
+            }
+
+            // The error levels went to stderr, but the decoded log is read as a whole
+            std::cout << line << '\n';
+        }
+        // The records of a newer version are skipped by their size
+    }
+
+    return 0;
+}